@@ -31,6 +31,26 @@ const char *fakewire_codec_symbol(fw_ctrl_t c) {
     }
 }
 
+// returns the length of the run of ordinary data bytes at the start of the buffer, i.e. the offset of the first byte
+// that would need to be escaped (or that is itself a control character), scanning a word at a time.
+static size_t fakewire_plain_run(const uint8_t *bytes, size_t length) {
+    size_t offset = 0;
+    while (offset + sizeof(uint32_t) <= length) {
+        uint32_t word;
+        memcpy(&word, &bytes[offset], sizeof(word));
+        // special bytes are exactly the bytes that are 0x80 after masking with 0xF8, so turn them into zero bytes
+        uint32_t masked = (word & 0xF8F8F8F8u) ^ 0x80808080u;
+        if (((masked - 0x01010101u) & ~masked & 0x80808080u) != 0) {
+            break;
+        }
+        offset += sizeof(uint32_t);
+    }
+    while (offset < length && !fakewire_is_special(bytes[offset])) {
+        offset++;
+    }
+    return offset;
+}
+
 void fakewire_dec_reset(fw_decoder_t *fwd, fw_decoder_synch_t *synch) {
     assert(fwd != NULL);
     // when ducts are used as streams, there is no need to separate their elements.
@@ -80,6 +100,27 @@ static bool fakewire_dec_internal_decode(fw_decoder_t *fwd, fw_decoder_synch_t *
         assert(fwd->mut->rx_offset < fwd->mut->rx_length);
         assert(decoded->data_out == NULL || decoded->data_actual_len < decoded->data_max_len);
 
+        if (!synch->recv_in_escape) {
+            // bulk path: pass along the entire run of ordinary data bytes before the next special byte at once
+            size_t run = fakewire_plain_run(&fwd->rx_buffer[fwd->mut->rx_offset],
+                                            fwd->mut->rx_length - fwd->mut->rx_offset);
+            if (decoded->data_out != NULL) {
+                if (run > decoded->data_max_len - decoded->data_actual_len) {
+                    run = decoded->data_max_len - decoded->data_actual_len;
+                }
+                memcpy(&decoded->data_out[decoded->data_actual_len], &fwd->rx_buffer[fwd->mut->rx_offset], run);
+            }
+            decoded->data_actual_len += run;
+            fwd->mut->rx_offset += run;
+            if (run > 0) {
+                if (decoded->data_out != NULL && decoded->data_actual_len == decoded->data_max_len) {
+                    return true;
+                }
+                continue;
+            }
+        }
+
+        // byte path: handle escape sequences and control characters
         uint8_t cur_byte = fwd->rx_buffer[fwd->mut->rx_offset++];
 
         if (synch->recv_in_escape) {
@@ -242,23 +283,29 @@ size_t fakewire_enc_encode_data(fw_encoder_t *fwe, const uint8_t *bytes_in, size
     assert(fwe != NULL && bytes_in != NULL);
     assert(byte_count > 0);
 
-    size_t in_offset;
-    for (in_offset = 0; in_offset < byte_count; in_offset++) {
-        uint8_t byte = bytes_in[in_offset];
+    size_t in_offset = 0;
+    while (in_offset < byte_count) {
+        // bulk path: copy the entire run of bytes that do not need escaping at once
+        size_t run = fakewire_plain_run(&bytes_in[in_offset], byte_count - in_offset);
+        if (run > fwe->tx_capacity - fwe->mut->tx_offset) {
+            run = fwe->tx_capacity - fwe->mut->tx_offset;
+        }
+        memcpy(&fwe->tx_buffer[fwe->mut->tx_offset], &bytes_in[in_offset], run);
+        fwe->mut->tx_offset += run;
+        in_offset += run;
 
-        if (fakewire_is_special(byte)) {
-            if (fwe->mut->tx_offset + 2 > fwe->tx_capacity) {
-                break;
-            }
-            fwe->tx_buffer[fwe->mut->tx_offset++] = FWC_ESCAPE_SYM;
-            // encode byte so that it remains in the data range
-            byte ^= 0x10;
-        } else {
-            if (fwe->mut->tx_offset + 1 > fwe->tx_capacity) {
-                break;
-            }
+        if (in_offset == byte_count || !fakewire_is_special(bytes_in[in_offset])) {
+            // either done, or stopped because the buffer is full
+            break;
+        }
+
+        // byte path: escape the special byte
+        if (fwe->mut->tx_offset + 2 > fwe->tx_capacity) {
+            break;
         }
-        fwe->tx_buffer[fwe->mut->tx_offset++] = byte;
+        fwe->tx_buffer[fwe->mut->tx_offset++] = FWC_ESCAPE_SYM;
+        // encode byte so that it remains in the data range
+        fwe->tx_buffer[fwe->mut->tx_offset++] = bytes_in[in_offset++] ^ 0x10;
     }
 #ifdef CODEC_DEBUG
     debugf(TRACE, "Encoded %zu/%zu raw data bytes.", in_offset, byte_count);
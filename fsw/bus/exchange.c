@@ -475,11 +475,15 @@ static bool exchange_instance_transmit_data(fw_exchange_t *conf, struct fakewire
     return true;
 }
 
-static struct fakewire_exchange_note *fakewire_exc_feedforward(fw_exchange_t *conf) {
-    assert(conf != NULL);
+// the exchange state is modified from too many places to mark each write dirty individually, so the caller keeps a
+// copy of the voted state in *baseline, and passes it to fakewire_exc_feedforward_done once the clip is finished.
+static struct fakewire_exchange_note *fakewire_exc_feedforward(fw_exchange_t *conf,
+                                                               struct fakewire_exchange_note *baseline) {
+    assert(conf != NULL && baseline != NULL);
     bool valid = false;
-    struct fakewire_exchange_note *exc = notepad_feedforward(conf->mut_synch, &valid);
+    struct fakewire_exchange_note *exc = notepad_feedforward_tracked(conf->mut_synch, &valid);
     assert(exc != NULL);
+    *baseline = *exc;
 
     uint32_t random_number = fakewire_exc_receive_random_number(conf);
 
@@ -497,9 +501,15 @@ static struct fakewire_exchange_note *fakewire_exc_feedforward(fw_exchange_t *co
     return exc;
 }
 
+static void fakewire_exc_feedforward_done(fw_exchange_t *conf, const struct fakewire_exchange_note *baseline) {
+    assert(conf != NULL && baseline != NULL);
+    notepad_mark_changes(conf->mut_synch, baseline);
+}
+
 void fakewire_exc_tx_clip(fw_exchange_t *conf) {
     assert(conf != NULL);
-    struct fakewire_exchange_note *exc = fakewire_exc_feedforward(conf);
+    struct fakewire_exchange_note baseline;
+    struct fakewire_exchange_note *exc = fakewire_exc_feedforward(conf, &baseline);
     assert(exc != NULL);
 
     exchange_instance_check_invariants(exc);
@@ -527,11 +537,14 @@ void fakewire_exc_tx_clip(fw_exchange_t *conf) {
 
     duct_receive_commit(&recv_txn);
     fakewire_enc_commit(conf->encoder);
+
+    fakewire_exc_feedforward_done(conf, &baseline);
 }
 
 void fakewire_exc_rx_clip(fw_exchange_t *conf) {
     assert(conf != NULL);
-    struct fakewire_exchange_note *exc = fakewire_exc_feedforward(conf);
+    struct fakewire_exchange_note baseline;
+    struct fakewire_exchange_note *exc = fakewire_exc_feedforward(conf, &baseline);
     assert(exc != NULL);
 
     exchange_instance_check_invariants(exc);
@@ -541,11 +554,12 @@ void fakewire_exc_rx_clip(fw_exchange_t *conf) {
     duct_txn_t send_txn;
     duct_send_prepare(&send_txn, conf->read_duct, conf->exchange_replica_id);
     fakewire_dec_prepare(conf->decoder);
-    // keep receiving data up to the processing limit, which should be plenty for ordinary situations. if we exceed
-    // this limit, then we're probably catching up after a reset, and we don't want to keep going, because then we'll
-    // run out of time. just dump everything else and try again.
-    duct_flow_index receive_limit = duct_max_flow(conf->read_duct) * 2;
-    duct_flow_index remaining_limit = receive_limit;
+    // keep receiving data up to the processing limit, which leaves room for every packet the read duct can carry in
+    // one epoch, back-to-back. if we exceed this limit, then we're probably catching up after a reset, and we don't
+    // want to keep going, because then we'll run out of time. just dump everything else and try again.
+    uint32_t receive_limit = duct_max_flow(conf->read_duct) * EXCHANGE_DECODE_ENTRIES_PER_PACKET
+                                + EXCHANGE_DECODE_ENTRIES_EXTRA;
+    uint32_t remaining_limit = receive_limit;
     while (exchange_instance_receive(conf, exc, &send_txn)) {
         if (--remaining_limit == 0) {
             size_t remaining = fakewire_dec_remaining_bytes(conf->decoder);
@@ -561,4 +575,6 @@ void fakewire_exc_rx_clip(fw_exchange_t *conf) {
     fakewire_dec_commit(conf->decoder);
 
     exchange_instance_check_fcts(conf, exc);
+
+    fakewire_exc_feedforward_done(conf, &baseline);
 }
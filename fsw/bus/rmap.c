@@ -18,57 +18,99 @@ void rmap_epoch_prepare(rmap_txn_t *txn, rmap_replica_t *rmap, rmap_synch_t *syn
     assert(txn != NULL && rmap != NULL && synch != NULL);
     txn->rmap = rmap;
     txn->synch = synch;
+    // the scratch buffer is shared between all replicas.
+    clip_note_access(rmap->scratch, CLIP_ACCESS_EXCLUSIVE);
     duct_send_prepare(&txn->tx_send_txn, rmap->tx_duct, rmap->replica_id);
     duct_receive_prepare(&txn->rx_recv_txn, rmap->rx_duct, rmap->replica_id);
+
+    // collect every reply up front, so that completions can claim them by transaction ID in any order.
+    assert(duct_max_flow(rmap->rx_duct) <= RMAP_MAX_INFLIGHT);
+    txn->num_replies = 0;
+    while (txn->num_replies < RMAP_MAX_INFLIGHT) {
+        rmap_reply_t *reply = &txn->replies[txn->num_replies];
+        reply->length = duct_receive_borrow(&txn->rx_recv_txn, &reply->data, &reply->timestamp);
+        if (reply->length == 0) {
+            break;
+        }
+        reply->claimed = false;
+        txn->num_replies++;
+    }
 }
 
 void rmap_epoch_commit(rmap_txn_t *txn) {
-    /* make sure that, if we received a packet, we've taken it out of the receive queue to avoid an assert. */
-    static_assert(RMAP_MAX_IO_FLOW == 1, "should only be one message accepted per epoch");
-    if (duct_receive_message(&txn->rx_recv_txn, NULL, NULL) > 0) {
-        debugf(WARNING, "RMAP (%10s) dropped packet received at unexpected time.", txn->rmap->label);
+    for (size_t i = 0; i < txn->num_replies; i++) {
+        if (!txn->replies[i].claimed) {
+            debugf(WARNING, "RMAP (%10s) dropped packet received at unexpected time (len=%zu).",
+                   txn->rmap->label, txn->replies[i].length);
+        }
     }
 
     duct_send_commit(&txn->tx_send_txn);
     duct_receive_commit(&txn->rx_recv_txn);
 }
 
-void rmap_write_start(rmap_txn_t *txn, uint8_t ext_addr, uint32_t main_addr, uint8_t *buffer, size_t data_length) {
-    assert(txn != NULL);
-    rmap_replica_t *rmap = txn->rmap;
-    assert(rmap != NULL && buffer != NULL);
-    assert(data_length <= duct_message_size(rmap->tx_duct) - SCRATCH_MARGIN_WRITE);
-
-#ifdef RMAP_TRACE
-    debugf(TRACE, "RMAP (%10s) WRITE START: ADDR=0x%02x_%08x LEN=0x%zx",
-           rmap->label, ext_addr, main_addr, data_length);
-#endif
-
-    if (!duct_send_allowed(&txn->tx_send_txn)) {
-        abortf("RMAP (%10s) not permitted to transmit another packet during this epoch.", rmap->label);
+// returns the next unclaimed packet received this epoch, starting at *index, that appears to be a reply to the
+// specified transaction. the caller must validate it before claiming it, so that a corrupted packet that happens to
+// carry the right transaction ID cannot stand in for the real reply.
+static rmap_reply_t *rmap_next_reply(rmap_txn_t *txn, uint16_t txn_id, size_t *index) {
+    assert(txn != NULL && index != NULL);
+    while (*index < txn->num_replies) {
+        rmap_reply_t *reply = &txn->replies[(*index)++];
+        // the transaction ID is at the same offset in both read and write replies
+        if (!reply->claimed && reply->length >= 7 && ((reply->data[5] << 8) | reply->data[6]) == txn_id) {
+            return reply;
+        }
     }
+    return NULL;
+}
 
-    uint8_t *out = rmap->scratch;
-    memset(out, 0, duct_message_size(rmap->tx_duct));
-    // and then start writing output bytes according to the write command format
-    if (rmap->routing->destination.num_path_bytes > 0) {
-        assert(rmap->routing->destination.num_path_bytes <= RMAP_MAX_PATH);
-        assert(rmap->routing->destination.path_bytes != NULL);
-        memcpy(out, rmap->routing->destination.path_bytes, rmap->routing->destination.num_path_bytes);
-        out += rmap->routing->destination.num_path_bytes;
+void rmap_header_init(rmap_replica_t *rmap) {
+    assert(rmap != NULL && rmap->header != NULL && rmap->routing != NULL);
+    const rmap_addr_t *routing = rmap->routing;
+    rmap_header_t *header = rmap->header;
+
+    uint8_t *out = header->prefix;
+    if (routing->destination.num_path_bytes > 0) {
+        assert(routing->destination.num_path_bytes <= RMAP_MAX_PATH);
+        assert(routing->destination.path_bytes != NULL);
+        memcpy(out, routing->destination.path_bytes, routing->destination.num_path_bytes);
+        out += routing->destination.num_path_bytes;
     }
     uint8_t *header_region = out;
-    *out++ = rmap->routing->destination.logical_address;
+    *out++ = routing->destination.logical_address;
     *out++ = PROTOCOL_RMAP;
-    int spal = (rmap->routing->source.num_path_bytes + 3) / 4;
+    header->flags_offset = out - header->prefix;
+    int spal = (routing->source.num_path_bytes + 3) / 4;
     assert((spal & RF_SOURCEPATH) == spal);
-    *out++ = RF_COMMAND | RF_WRITE | RF_VERIFY | RF_ACKNOWLEDGE | RF_INCREMENT | spal;
-    *out++ = rmap->routing->dest_key;
-    rmap_encode_source_path(&out, &rmap->routing->source);
-    *out++ = rmap->routing->source.logical_address;
+    header->flags_write = RF_COMMAND | RF_WRITE | RF_VERIFY | RF_ACKNOWLEDGE | RF_INCREMENT | spal;
+    header->flags_read  = RF_COMMAND | RF_ACKNOWLEDGE | RF_INCREMENT | spal;
+    *out++ = header->flags_write;
+    *out++ = routing->dest_key;
+    rmap_encode_source_path(&out, &routing->source);
+    *out++ = routing->source.logical_address;
+    header->prefix_length = out - header->prefix;
+    assert(header->prefix_length <= RMAP_HEADER_PREFIX_MAX);
+
+    // the header CRC is computed incrementally, so the prefix only has to be covered once.
+    header->crc_write = rmap_crc8(header_region, out - header_region);
+    header->prefix[header->flags_offset] = header->flags_read;
+    header->crc_read = rmap_crc8(header_region, out - header_region);
+}
+
+// copies the endpoint's prefix into the scratch buffer, fills in the fields that vary between transactions, and returns
+// the position just past the header CRC. only the header is written, not the rest of the scratch buffer.
+static uint8_t *rmap_build_header(rmap_txn_t *txn, bool write, uint8_t ext_addr, uint32_t main_addr,
+                                  size_t data_length) {
+    rmap_replica_t *rmap = txn->rmap;
+    const rmap_header_t *header = rmap->header;
+
+    memcpy(rmap->scratch, header->prefix, header->prefix_length);
+    rmap->scratch[header->flags_offset] = write ? header->flags_write : header->flags_read;
 
     txn->synch->current_txn_id += 1;
 
+    uint8_t *variable_region = &rmap->scratch[header->prefix_length];
+    uint8_t *out = variable_region;
     *out++ = (txn->synch->current_txn_id >> 8) & 0xFF;
     *out++ = (txn->synch->current_txn_id >> 0) & 0xFF;
     *out++ = ext_addr;
@@ -80,10 +122,30 @@ void rmap_write_start(rmap_txn_t *txn, uint8_t ext_addr, uint32_t main_addr, uin
     *out++ = (data_length >> 16) & 0xFF;
     *out++ = (data_length >> 8) & 0xFF;
     *out++ = (data_length >> 0) & 0xFF;
-    // compute the header CRC
-    uint8_t header_crc = rmap_crc8(header_region, out - header_region);
-    *out++ = header_crc;
+    // finish the header CRC
+    uint8_t crc_prefix = write ? header->crc_write : header->crc_read;
+    *out = rmap_crc8_extend(crc_prefix, variable_region, out - variable_region);
+    out++;
+    return out;
+}
+
+uint16_t rmap_write_start(rmap_txn_t *txn, uint8_t ext_addr, uint32_t main_addr,
+                          uint8_t *buffer, size_t data_length) {
+    assert(txn != NULL);
+    rmap_replica_t *rmap = txn->rmap;
+    assert(rmap != NULL && buffer != NULL);
+    assert(data_length <= duct_message_size(rmap->tx_duct) - SCRATCH_MARGIN_WRITE);
+
+#ifdef RMAP_TRACE
+    debugf(TRACE, "RMAP (%10s) WRITE START: ADDR=0x%02x_%08x LEN=0x%zx",
+           rmap->label, ext_addr, main_addr, data_length);
+#endif
+
+    if (!duct_send_allowed(&txn->tx_send_txn)) {
+        abortf("RMAP (%10s) not permitted to transmit another packet during this epoch.", rmap->label);
+    }
 
+    uint8_t *out = rmap_build_header(txn, true, ext_addr, main_addr, data_length);
     memcpy(out, buffer, data_length);
     out += data_length;
 
@@ -92,11 +154,13 @@ void rmap_write_start(rmap_txn_t *txn, uint8_t ext_addr, uint32_t main_addr, uin
     size_t packet_length = out - rmap->scratch;
     assert(packet_length <= duct_message_size(rmap->tx_duct));
     duct_send_message(&txn->tx_send_txn, rmap->scratch, packet_length, 0 /* no timestamp needed */);
+    return txn->synch->current_txn_id;
 }
 
 // returns true if packet is a valid reply, and false otherwise.
-static bool rmap_validate_write_reply(rmap_txn_t *txn, uint8_t *in, size_t count, uint8_t *status_byte_out) {
-    assert(txn != NULL && txn->rmap != NULL && txn->synch != NULL && in != NULL && status_byte_out != NULL);
+static bool rmap_validate_write_reply(rmap_txn_t *txn, uint16_t expected_txn_id, const uint8_t *in, size_t count,
+                                      uint8_t *status_byte_out) {
+    assert(txn != NULL && txn->rmap != NULL && in != NULL && status_byte_out != NULL);
     rmap_replica_t *rmap = txn->rmap;
     // validate basic parameters of a valid RMAP packet
     if (count < 8) {
@@ -129,9 +193,9 @@ static bool rmap_validate_write_reply(rmap_txn_t *txn, uint8_t *in, size_t count
     }
     // verify transaction ID
     uint16_t txn_id = (in[5] << 8) | in[6];
-    if (txn_id != txn->synch->current_txn_id) {
+    if (txn_id != expected_txn_id) {
         debugf(WARNING, "RMAP (%10s) dropped write reply with wrong transaction ID (found=0x%04x, expected=0x%04x).",
-               rmap->label, txn_id, txn->synch->current_txn_id);
+               rmap->label, txn_id, expected_txn_id);
         return false;
     }
     // make sure routing addresses match
@@ -146,24 +210,28 @@ static bool rmap_validate_write_reply(rmap_txn_t *txn, uint8_t *in, size_t count
 }
 
 // this should be called one epoch later, to give the networking infrastructure time to respond
-rmap_status_t rmap_write_complete(rmap_txn_t *txn, local_time_t *ack_timestamp_out) {
+rmap_status_t rmap_write_complete_id(rmap_txn_t *txn, uint16_t txn_id, local_time_t *ack_timestamp_out) {
     assert(txn != NULL);
     rmap_replica_t *rmap = txn->rmap;
     assert(rmap != NULL);
 
     uint8_t status_byte;
-    local_time_t timestamp = 0;
-    size_t packet_length = duct_receive_message(&txn->rx_recv_txn, rmap->scratch, &timestamp);
-    if (packet_length == 0 || !rmap_validate_write_reply(txn, rmap->scratch, packet_length, &status_byte)) {
-        // no need to check for further packets... our duct only allows one packet per epoch!
+    rmap_reply_t *reply;
+    size_t index = 0;
+    while ((reply = rmap_next_reply(txn, txn_id, &index)) != NULL
+            && !rmap_validate_write_reply(txn, txn_id, reply->data, reply->length, &status_byte)) {
+        // keep looking, in case the real reply arrived after a corrupted one
+    }
+    if (reply == NULL) {
 #ifdef RMAP_TRACE
         debugf(TRACE, "RMAP (%10s) WRITE  FAIL: NO RESPONSE", rmap->label);
 #endif
         return RS_NO_RESPONSE;
     }
+    reply->claimed = true;
 
     if (ack_timestamp_out) {
-        *ack_timestamp_out = timestamp;
+        *ack_timestamp_out = reply->timestamp;
     }
 
 #ifdef RMAP_TRACE
@@ -173,7 +241,12 @@ rmap_status_t rmap_write_complete(rmap_txn_t *txn, local_time_t *ack_timestamp_o
     return status_byte;
 }
 
-void rmap_read_start(rmap_txn_t *txn, uint8_t ext_addr, uint32_t main_addr, size_t data_length) {
+rmap_status_t rmap_write_complete(rmap_txn_t *txn, local_time_t *ack_timestamp_out) {
+    assert(txn != NULL && txn->synch != NULL);
+    return rmap_write_complete_id(txn, txn->synch->current_txn_id, ack_timestamp_out);
+}
+
+uint16_t rmap_read_start(rmap_txn_t *txn, uint8_t ext_addr, uint32_t main_addr, size_t data_length) {
     assert(txn != NULL);
     rmap_replica_t *rmap = txn->rmap;
     assert(rmap != NULL);
@@ -188,53 +261,18 @@ void rmap_read_start(rmap_txn_t *txn, uint8_t ext_addr, uint32_t main_addr, size
         abortf("RMAP (%10s) not permitted to transmit another packet during this epoch.", rmap->label);
     }
 
-    uint8_t *out = rmap->scratch;
-    memset(out, 0, duct_message_size(rmap->tx_duct));
-
-    // start writing output bytes according to the read command format
-    if (rmap->routing->destination.num_path_bytes > 0) {
-        assert(rmap->routing->destination.num_path_bytes <= RMAP_MAX_PATH);
-        assert(rmap->routing->destination.path_bytes != NULL);
-        memcpy(out, rmap->routing->destination.path_bytes, rmap->routing->destination.num_path_bytes);
-        out += rmap->routing->destination.num_path_bytes;
-    }
-    uint8_t *header_region = out;
-    *out++ = rmap->routing->destination.logical_address;
-    *out++ = PROTOCOL_RMAP;
-    int spal = (rmap->routing->source.num_path_bytes + 3) / 4;
-    assert((spal & RF_SOURCEPATH) == spal);
-    *out++ = RF_COMMAND | RF_ACKNOWLEDGE | RF_INCREMENT | spal;
-    *out++ = rmap->routing->dest_key;
-    rmap_encode_source_path(&out, &rmap->routing->source);
-    *out++ = rmap->routing->source.logical_address;
-
-    txn->synch->current_txn_id += 1;
-
-    *out++ = (txn->synch->current_txn_id >> 8) & 0xFF;
-    *out++ = (txn->synch->current_txn_id >> 0) & 0xFF;
-    *out++ = ext_addr;
-    *out++ = (main_addr >> 24) & 0xFF;
-    *out++ = (main_addr >> 16) & 0xFF;
-    *out++ = (main_addr >> 8) & 0xFF;
-    *out++ = (main_addr >> 0) & 0xFF;
-    assert((data_length >> 24) == 0); // should already be guaranteed by previous checks, but just in case
-    *out++ = (data_length >> 16) & 0xFF;
-    *out++ = (data_length >> 8) & 0xFF;
-    *out++ = (data_length >> 0) & 0xFF;
-
-    // compute the header CRC
-    uint8_t header_crc = rmap_crc8(header_region, out - header_region);
-    *out++ = header_crc;
+    uint8_t *out = rmap_build_header(txn, false, ext_addr, main_addr, data_length);
 
     size_t packet_length = out - rmap->scratch;
     assert(packet_length <= duct_message_size(rmap->tx_duct));
     duct_send_message(&txn->tx_send_txn, rmap->scratch, packet_length, 0 /* no timestamp needed */);
+    return txn->synch->current_txn_id;
 }
 
 // returns true if packet is a valid reply, and false otherwise.
-static bool rmap_validate_read_reply(rmap_txn_t *txn, uint8_t *in, size_t count,
+static bool rmap_validate_read_reply(rmap_txn_t *txn, uint16_t expected_txn_id, const uint8_t *in, size_t count,
                                      uint8_t *status_byte_out, uint8_t *packet_out, size_t *packet_length_io) {
-    assert(txn != NULL && txn->rmap != NULL && txn->synch != NULL && in != NULL && status_byte_out != NULL
+    assert(txn != NULL && txn->rmap != NULL && in != NULL && status_byte_out != NULL
                        && packet_out != NULL && packet_length_io != NULL);
     rmap_replica_t *rmap = txn->rmap;
     // validate basic parameters of a valid RMAP packet
@@ -275,7 +313,7 @@ static bool rmap_validate_read_reply(rmap_txn_t *txn, uint8_t *in, size_t count,
                rmap->label, data_length, count - 13);
         return false;
     }
-    uint8_t *data_ptr = &in[12];
+    const uint8_t *data_ptr = &in[12];
     uint8_t data_crc = rmap_crc8(data_ptr, data_length);
     if (data_crc != in[count - 1]) {
         debugf(WARNING, "RMAP (%10s) dropped read reply with invalid data CRC (found=0x%02x, expected=0x%02x).",
@@ -284,9 +322,9 @@ static bool rmap_validate_read_reply(rmap_txn_t *txn, uint8_t *in, size_t count,
     }
     // verify transaction ID
     uint16_t txn_id = (in[5] << 8) | in[6];
-    if (txn_id != txn->synch->current_txn_id) {
+    if (txn_id != expected_txn_id) {
         debugf(WARNING, "RMAP (%10s) dropped read reply with wrong transaction ID (found=0x%04x, expected=0x%04x).",
-               rmap->label, txn_id, txn->synch->current_txn_id);
+               rmap->label, txn_id, expected_txn_id);
         return false;
     }
     // make sure routing addresses match
@@ -306,25 +344,30 @@ static bool rmap_validate_read_reply(rmap_txn_t *txn, uint8_t *in, size_t count,
     return true;
 }
 
-rmap_status_t rmap_read_complete(rmap_txn_t *txn, uint8_t *buffer, size_t buffer_size, local_time_t *ack_timestamp_out) {
+rmap_status_t rmap_read_complete_id(rmap_txn_t *txn, uint16_t txn_id,
+                                    uint8_t *buffer, size_t buffer_size, local_time_t *ack_timestamp_out) {
     assert(txn != NULL);
     rmap_replica_t *rmap = txn->rmap;
     assert(rmap != NULL && buffer != NULL);
 
     uint8_t status_byte;
     size_t output_length = buffer_size;
-    local_time_t timestamp = 0;
-    size_t packet_length = duct_receive_message(&txn->rx_recv_txn, rmap->scratch, &timestamp);
-    if (packet_length == 0 || !rmap_validate_read_reply(txn, rmap->scratch, packet_length,
-                                                        &status_byte, buffer, &output_length)) {
-        // no need to check for further packets... our duct only allows one packet per epoch!
+    rmap_reply_t *reply;
+    size_t index = 0;
+    while ((reply = rmap_next_reply(txn, txn_id, &index)) != NULL
+            && !rmap_validate_read_reply(txn, txn_id, reply->data, reply->length,
+                                         &status_byte, buffer, &output_length)) {
+        // keep looking, in case the real reply arrived after a corrupted one
+    }
+    if (reply == NULL) {
 #ifdef RMAP_TRACE
         debugf(TRACE, "RMAP (%10s)  READ  FAIL: NO RESPONSE", rmap->label);
 #endif
         return RS_NO_RESPONSE;
     }
+    reply->claimed = true;
     if (ack_timestamp_out) {
-        *ack_timestamp_out = timestamp;
+        *ack_timestamp_out = reply->timestamp;
     }
     if (status_byte != RS_OK) {
 #ifdef RMAP_TRACE
@@ -344,3 +387,8 @@ rmap_status_t rmap_read_complete(rmap_txn_t *txn, uint8_t *buffer, size_t buffer
         return RS_OK;
     }
 }
+
+rmap_status_t rmap_read_complete(rmap_txn_t *txn, uint8_t *buffer, size_t buffer_size, local_time_t *ack_timestamp_out) {
+    assert(txn != NULL && txn->synch != NULL);
+    return rmap_read_complete_id(txn, txn->synch->current_txn_id, buffer, buffer_size, ack_timestamp_out);
+}
@@ -9,29 +9,16 @@
 
 // returns TRUE if packet is consumed.
 static void switch_packet(switch_t *sw, uint8_t replica_id, int port,
-                          size_t message_size, local_time_t timestamp, uint8_t *message_buffer) {
+                          size_t message_size, local_time_t timestamp, const uint8_t *message_buffer) {
     uint8_t destination = message_buffer[0];
-    if (destination < SWITCH_PORT_BASE) {
-        debugf(WARNING, "Switch replica %u port %u: dropped packet (len=%zu) to invalid address %u.",
+    uint8_t route = sw->routing_table[destination];
+    if (!(route & SWITCH_ROUTE_FLAG_ENABLED)) {
+        debugf(WARNING, "Switch replica %u port %u: dropped packet (len=%zu) to unroutable address %u.",
                replica_id, port, message_size, destination);
         return;
     }
-    bool address_pop = true;
-    int outport = destination;
-    if (destination >= SWITCH_ROUTE_BASE) {
-        assert(destination - SWITCH_ROUTE_BASE < SWITCH_ROUTES);
-        uint8_t route = sw->routing_table[destination - SWITCH_ROUTE_BASE];
-        if (!(route & SWITCH_ROUTE_FLAG_ENABLED)) {
-            debugf(WARNING, "Switch replica %u port %u: dropped packet (len=%zu) to nonexistent route %u.",
-                   replica_id, port, message_size, destination);
-            return;
-        }
-        if (!(route & SWITCH_ROUTE_FLAG_POP)) {
-            address_pop = false;
-        }
-        outport = (route & SWITCH_ROUTE_PORT_MASK);
-        assert(SWITCH_PORT_BASE <= outport && outport < SWITCH_PORT_BASE + SWITCH_PORTS);
-    }
+    bool address_pop = (route & SWITCH_ROUTE_FLAG_POP) != 0;
+    int outport = (route & SWITCH_ROUTE_PORT_MASK);
     assert(SWITCH_PORT_BASE <= outport && outport < SWITCH_PORT_BASE + SWITCH_PORTS);
     switch_port_t *swport = &sw->ports[outport - SWITCH_PORT_BASE];
     if (!swport->outbound) {
@@ -71,18 +58,48 @@ static void switch_packet(switch_t *sw, uint8_t replica_id, int port,
 #endif
 }
 
+// returns the i'th active port. the list of active ports is mutable state, so make sure that it still only refers to
+// ports that exist before indexing with it.
+static switch_port_t *switch_active_port(switch_t *sw, uint8_t i) {
+    assert(sw->num_active_ports <= SWITCH_PORTS && i < sw->num_active_ports);
+    assert(sw->active_ports[i] < SWITCH_PORTS);
+    return &sw->ports[sw->active_ports[i]];
+}
+
+void switch_activate_port(switch_t *sw, uint8_t port) {
+    assert(sw != NULL);
+    assert(SWITCH_PORT_BASE <= port && port < SWITCH_PORT_BASE + SWITCH_PORTS);
+    uint8_t index = port - SWITCH_PORT_BASE;
+    for (uint8_t i = 0; i < sw->num_active_ports; i++) {
+        if (switch_active_port(sw, i) == &sw->ports[index]) {
+            return;
+        }
+    }
+    // keep ports in ascending order, so that they are processed in the same order as before
+    assert(sw->num_active_ports < SWITCH_PORTS);
+    uint8_t insert = sw->num_active_ports;
+    while (insert > 0 && sw->active_ports[insert - 1] > index) {
+        sw->active_ports[insert] = sw->active_ports[insert - 1];
+        insert--;
+    }
+    sw->active_ports[insert] = index;
+    sw->num_active_ports++;
+}
+
 void switch_io_clip(const switch_replica_t *sr) {
     assert(sr != NULL);
     uint8_t replica_id = sr->replica_id;
     switch_t *sw = sr->replica_switch;
     assert(sw != NULL);
+    // the port transactions are stored in the switch itself, rather than per replica.
+    clip_note_access(sw, CLIP_ACCESS_EXCLUSIVE);
 
     // attempt to perform transfer for each port
     unsigned int packets = 0;
 
     // first, prepare all transactions
-    for (int port = SWITCH_PORT_BASE; port < SWITCH_PORT_BASE + SWITCH_PORTS; port++) {
-        switch_port_t *swport = &sw->ports[port - SWITCH_PORT_BASE];
+    for (uint8_t i = 0; i < sw->num_active_ports; i++) {
+        switch_port_t *swport = switch_active_port(sw, i);
         if (swport->inbound != NULL) {
             duct_receive_prepare(&swport->inbound_txn, swport->inbound, replica_id);
         }
@@ -92,22 +109,25 @@ void switch_io_clip(const switch_replica_t *sr) {
     }
 
     // now shuffle all messages
-    for (int port = SWITCH_PORT_BASE; port < SWITCH_PORT_BASE + SWITCH_PORTS; port++) {
-        switch_port_t *swport = &sw->ports[port - SWITCH_PORT_BASE];
+    for (uint8_t i = 0; i < sw->num_active_ports; i++) {
+        switch_port_t *swport = switch_active_port(sw, i);
+        int port = SWITCH_PORT_BASE + (swport - sw->ports);
         if (swport->inbound != NULL) {
             local_time_t timestamp = 0;
+            const uint8_t *message;
             size_t message_size;
-            while ((message_size = duct_receive_message(&swport->inbound_txn, sr->scratch_buffer, &timestamp)) != 0) {
-                assert(message_size <= sw->scratch_buffer_size);
-                switch_packet(sw, replica_id, port, message_size, timestamp, sr->scratch_buffer);
+            // forward packets directly out of the inbound duct, without copying them into a scratch buffer first
+            while ((message_size = duct_receive_borrow(&swport->inbound_txn, &message, &timestamp)) != 0) {
+                assert(message_size <= sw->max_packet_size);
+                switch_packet(sw, replica_id, port, message_size, timestamp, message);
                 packets++;
             }
         }
     }
 
     // finally, commit all transactions
-    for (int port = SWITCH_PORT_BASE; port < SWITCH_PORT_BASE + SWITCH_PORTS; port++) {
-        switch_port_t *swport = &sw->ports[port - SWITCH_PORT_BASE];
+    for (uint8_t i = 0; i < sw->num_active_ports; i++) {
+        switch_port_t *swport = switch_active_port(sw, i);
         if (swport->inbound != NULL) {
             duct_receive_commit(&swport->inbound_txn);
         }
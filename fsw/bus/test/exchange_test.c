@@ -159,22 +159,42 @@ static bool compare_packets(uint8_t *baseline, size_t baseline_len, uint8_t *act
 }
 */
 
+// set to 1 to connect the two exchanges through a shared-memory ring instead of a pair of FIFOs. the exchange_test_shm
+// build (see shm/) does this.
+#ifndef TESTING_SHARED_MEMORY_LINK
+#define TESTING_SHARED_MEMORY_LINK 0
+#endif
+
+#if ( TESTING_SHARED_MEMORY_LINK == 1 )
+#define TESTING_LINK_PREPARE(prefix)
+#define TESTING_LINK_PROD FW_FLAG_SHM_PROD
+#define TESTING_LINK_CONS FW_FLAG_SHM_CONS
+#else
+#define TESTING_LINK_PREPARE(prefix) FIFO_REGISTER(prefix);
+#define TESTING_LINK_PROD FW_FLAG_FIFO_PROD
+#define TESTING_LINK_CONS FW_FLAG_FIFO_CONS
+#endif
+
 #define TESTING_ASSEMBLY(t_ident, t_max_flow, t_max_packet)                                                           \
-    FIFO_REGISTER("./fwfifo");                                                                                        \
+    TESTING_LINK_PREPARE("./fwfifo")                                                                                  \
     const fw_link_options_t t_ident ## _left_options = {                                                              \
         .label = "left",                                                                                              \
         .path = "./fwfifo",                                                                                           \
-        .flags = FW_FLAG_FIFO_PROD,                                                                                   \
+        .flags = TESTING_LINK_PROD,                                                                                   \
     };                                                                                                                \
     const fw_link_options_t t_ident ## _right_options = {                                                             \
         .label = "right",                                                                                             \
         .path = "./fwfifo",                                                                                           \
-        .flags = FW_FLAG_FIFO_CONS,                                                                                   \
+        .flags = TESTING_LINK_CONS,                                                                                   \
     };                                                                                                                \
-    DUCT_REGISTER(t_ident ## _left_rx_duct,  1, 1, (t_max_flow) * 2, t_max_packet, DUCT_SENDER_FIRST);                \
-    DUCT_REGISTER(t_ident ## _left_tx_duct,  1, 1, (t_max_flow) * 2, t_max_packet, DUCT_RECEIVER_FIRST);              \
-    DUCT_REGISTER(t_ident ## _right_rx_duct, 1, 1, (t_max_flow) * 2, t_max_packet, DUCT_SENDER_FIRST);                \
-    DUCT_REGISTER(t_ident ## _right_tx_duct, 1, 1, (t_max_flow) * 2, t_max_packet, DUCT_RECEIVER_FIRST);              \
+    DUCT_REGISTER(t_ident ## _left_rx_duct,  EXCHANGE_REPLICAS, 1,                                                    \
+                  (t_max_flow) * 2, t_max_packet, DUCT_SENDER_FIRST);                                                 \
+    DUCT_REGISTER(t_ident ## _left_tx_duct,  1, EXCHANGE_REPLICAS,                                                    \
+                  (t_max_flow) * 2, t_max_packet, DUCT_RECEIVER_FIRST);                                               \
+    DUCT_REGISTER(t_ident ## _right_rx_duct, EXCHANGE_REPLICAS, 1,                                                    \
+                  (t_max_flow) * 2, t_max_packet, DUCT_SENDER_FIRST);                                                 \
+    DUCT_REGISTER(t_ident ## _right_tx_duct, 1, EXCHANGE_REPLICAS,                                                    \
+                  (t_max_flow) * 2, t_max_packet, DUCT_RECEIVER_FIRST);                                               \
     FAKEWIRE_EXCHANGE_REGISTER(t_ident ## _left,  t_ident ## _left_options,                                           \
                                t_ident ## _left_rx_duct,  t_ident ## _left_tx_duct,  t_max_flow, t_max_packet);       \
     FAKEWIRE_EXCHANGE_REGISTER(t_ident ## _right, t_ident ## _right_options,                                          \
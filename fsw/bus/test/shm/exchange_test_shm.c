@@ -0,0 +1,4 @@
+// builds exchange_test.c with its two exchanges connected through a shared-memory link instead of a pair of FIFOs
+#define TESTING_SHARED_MEMORY_LINK 1
+
+#include "../exchange_test.c"
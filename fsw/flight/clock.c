@@ -38,7 +38,27 @@ static void clock_configure(tlm_txn_t *telem, uint8_t replica_id,
     tlm_clock_calibrated(telem, adjustment);
 }
 
+static void clock_complete_time(clock_replica_t *cr, struct clock_replica_note *synch,
+                                rmap_txn_t *rmap_txn, tlm_txn_t *telem_txn) {
+    mission_time_t received_timestamp;
+    local_time_t network_timestamp;
+
+    rmap_status_t status = rmap_read_complete_id(rmap_txn, synch->time_txn_id, (uint8_t*) &received_timestamp,
+                                                 sizeof(received_timestamp), &network_timestamp);
+    if (status == RS_OK) {
+        received_timestamp = be64toh(received_timestamp);
+
+        clock_configure(telem_txn, cr->replica_id, received_timestamp, network_timestamp);
+
+        synch->state = CLOCK_CALIBRATED;
+    } else {
+        debugf(WARNING, "Failed to query clock current time, error=0x%03x", status);
+    }
+}
+
 void clock_voter_clip(void) {
+    // the fast adjustment is read by every clip that reports mission time.
+    clip_note_access(NULL, CLIP_ACCESS_BARRIER);
     clock_offset_adj_fast = clock_offset_adj_vote();
     size_t mismatches = 0;
     for (size_t i = 0; i < CLOCK_REPLICAS; i++) {
@@ -56,12 +76,11 @@ void clock_voter_clip(void) {
 
 void clock_start_clip(clock_replica_t *cr) {
     assert(cr != NULL);
+    clip_note_access(NULL, CLIP_ACCESS_BARRIER);
 
     // temporary local variables for switch statements
     rmap_status_t status;
     uint32_t magic_number;
-    mission_time_t received_timestamp;
-    local_time_t network_timestamp;
 
     bool valid = false;
     struct clock_replica_note *synch = notepad_feedforward(cr->synch, &valid);
@@ -78,29 +97,22 @@ void clock_start_clip(clock_replica_t *cr) {
 
     switch (synch->state) {
     case CLOCK_READ_MAGIC_NUMBER:
-        status = rmap_read_complete(&rmap_txn, (uint8_t*) &magic_number, sizeof(magic_number), NULL);
+        status = rmap_read_complete_id(&rmap_txn, synch->magic_txn_id,
+                                       (uint8_t*) &magic_number, sizeof(magic_number), NULL);
         if (status == RS_OK) {
             magic_number = be32toh(magic_number);
             if (magic_number != CLOCK_MAGIC_NUM) {
                 abortf("Clock sent incorrect magic number.");
             }
             synch->state = CLOCK_READ_CURRENT_TIME;
+            // the current time was read in the same epoch, but is only trusted once the magic number checks out
+            clock_complete_time(cr, synch, &rmap_txn, &telem_txn);
         } else {
             debugf(WARNING, "Failed to query clock magic number, error=0x%03x", status);
         }
         break;
     case CLOCK_READ_CURRENT_TIME:
-        status = rmap_read_complete(&rmap_txn, (uint8_t*) &received_timestamp, sizeof(received_timestamp),
-                                    &network_timestamp);
-        if (status == RS_OK) {
-            received_timestamp = be64toh(received_timestamp);
-
-            clock_configure(&telem_txn, cr->replica_id, received_timestamp, network_timestamp);
-
-            synch->state = CLOCK_CALIBRATED;
-        } else {
-            debugf(WARNING, "Failed to query clock current time, error=0x%03x", status);
-        }
+        clock_complete_time(cr, synch, &rmap_txn, &telem_txn);
         break;
     default:
         /* nothing to do */
@@ -115,10 +127,11 @@ void clock_start_clip(clock_replica_t *cr) {
 
     switch (synch->state) {
     case CLOCK_READ_MAGIC_NUMBER:
-        rmap_read_start(&rmap_txn, 0x00, REG_MAGIC, sizeof(magic_number));
+        synch->magic_txn_id = rmap_read_start(&rmap_txn, 0x00, REG_MAGIC, sizeof(magic_number));
+        synch->time_txn_id = rmap_read_start(&rmap_txn, 0x00, REG_CLOCK, sizeof(mission_time_t));
         break;
     case CLOCK_READ_CURRENT_TIME:
-        rmap_read_start(&rmap_txn, 0x00, REG_CLOCK, sizeof(received_timestamp));
+        synch->time_txn_id = rmap_read_start(&rmap_txn, 0x00, REG_CLOCK, sizeof(mission_time_t));
         break;
     default:
         /* nothing to do */
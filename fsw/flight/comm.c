@@ -1,6 +1,6 @@
 #include <endian.h>
 #include <stdint.h>
-#include <zlib.h> // for crc32
+#include <zlib.h> // for crc32 table
 
 #include <flight/comm.h>
 
@@ -20,6 +20,20 @@ enum {
     BYTE_ESC_EOP    = 0x33,
 };
 
+// the CRC is maintained incrementally, so that it can be computed in the same pass as escaping and unescaping. these
+// produce the same results as zlib's crc32(), using the same lookup table.
+static inline uint32_t comm_crc32_start(void) {
+    return 0xFFFFFFFF;
+}
+
+static inline uint32_t comm_crc32_step(const z_crc_t *table, uint32_t crc_register, uint8_t byte) {
+    return table[(crc_register ^ byte) & 0xFF] ^ (crc_register >> 8);
+}
+
+static inline uint32_t comm_crc32_finish(uint32_t crc_register) {
+    return crc_register ^ 0xFFFFFFFF;
+}
+
 static uint16_t comm_dec_next_symbol(comm_dec_t *dec) {
     // we can only proceed if we either have >=1 byte available (which is not BYTE_ESCAPE) or >=2 bytes available (if
     // the first one is BYTE_ESCAPE)
@@ -45,7 +59,8 @@ static uint16_t comm_dec_next_symbol(comm_dec_t *dec) {
     }
 }
 
-static bool comm_packet_decode(comm_packet_t *out, uint8_t *buffer, size_t length) {
+// computed_crc32 must be the CRC of everything in the buffer except the trailing CRC field itself
+static bool comm_packet_decode(comm_packet_t *out, uint8_t *buffer, size_t length, uint32_t computed_crc32) {
     // needs to be long enough to have all the fields
     if (length < 4 + 4 + 8 + 4) {
         return false;
@@ -59,7 +74,6 @@ static bool comm_packet_decode(comm_packet_t *out, uint8_t *buffer, size_t lengt
     }
     // check the CRC32
     uint32_t header_crc32   = be32toh(*(uint32_t*) (buffer + length - 4));
-    uint32_t computed_crc32 = crc32(0, buffer, length - 4);
     if (header_crc32 != computed_crc32) {
         return false;
     }
@@ -85,6 +99,7 @@ void comm_dec_prepare(comm_dec_t *dec) {
 
 // NOTE: the byte array produced here will be reused on the next call
 bool comm_dec_decode(comm_dec_t *dec, comm_packet_t *out) {
+    const z_crc_t *crc_table = get_crc_table();
     uint16_t symbol;
     bool success = false;
     while ((symbol = comm_dec_next_symbol(dec)) != SYMBOL_BUFFER_EMPTY) {
@@ -92,6 +107,7 @@ bool comm_dec_decode(comm_dec_t *dec, comm_packet_t *out) {
             if (symbol == SYMBOL_PACKET_START) {
                 dec->decode_in_progress = true;
                 dec->decode_offset = 0;
+                dec->decode_crc = comm_crc32_start();
             } else {
                 dec->err_count++;
             }
@@ -102,11 +118,17 @@ bool comm_dec_decode(comm_dec_t *dec, comm_packet_t *out) {
                     debugf(WARNING, "Comm packet decoder discarded packet of at least %zu bytes; exceeded decode "
                            "buffer size.", dec->decode_offset + 1);
                 } else {
+                    // the last four bytes are the CRC itself, so the running CRC lags four bytes behind the data.
+                    if (dec->decode_offset >= sizeof(uint32_t)) {
+                        dec->decode_crc = comm_crc32_step(crc_table, dec->decode_crc,
+                                                          dec->decode_buffer[dec->decode_offset - sizeof(uint32_t)]);
+                    }
                     dec->decode_buffer[dec->decode_offset++] = symbol;
                 }
             } else if (symbol == SYMBOL_PACKET_END) {
                 dec->decode_in_progress = false;
-                if (comm_packet_decode(out, dec->decode_buffer, dec->decode_offset)) {
+                if (comm_packet_decode(out, dec->decode_buffer, dec->decode_offset,
+                                       comm_crc32_finish(dec->decode_crc))) {
                     // valid packet!
                     success = true;
                     break;
@@ -140,14 +162,18 @@ static size_t comm_enc_estimate_length(const uint8_t *data, size_t len) {
     return total;
 }
 
-static void comm_enc_write_escaped(comm_enc_t *enc, const uint8_t *data, size_t len) {
+// escapes data into the output and extends the CRC over it in the same pass
+static uint32_t comm_enc_write_escaped(comm_enc_t *enc, const z_crc_t *table, uint32_t crc_register,
+                                       const uint8_t *data, size_t len) {
     for (size_t i = 0; i < len; i++) {
         uint8_t di = data[i];
+        crc_register = comm_crc32_step(table, crc_register, di);
         pipe_sender_write_byte(enc->downlink, di);
         if (di == BYTE_ESCAPE) {
             pipe_sender_write_byte(enc->downlink, BYTE_ESC_ESCAPE);
         }
     }
+    return crc_register;
 }
 
 void comm_enc_reset(comm_enc_t *enc) {
@@ -160,16 +186,24 @@ void comm_enc_prepare(comm_enc_t *enc) {
     pipe_sender_prepare(enc->downlink);
 }
 
-bool comm_enc_encode(comm_enc_t *enc, comm_packet_t *in) {
+bool comm_enc_fits(comm_enc_t *enc, const comm_packet_t *in, size_t headroom) {
     assert(enc != NULL && in != NULL);
 
-    size_t expected_length = 2 /* for start-of-packet */
-                           + sizeof(uint32_t) * 4 * 2 /* maximum size of the header fields encoded */
-                           + comm_enc_estimate_length(in->data_bytes, in->data_len) /* body bytes */
-                           + sizeof(uint32_t) * 2 /* maximum size of the CRC encoded */
-                           + 2;
+    assert(in->data_len <= COMM_ENC_MAX_DATA_LENGTH);
+
+    size_t space = pipe_sender_space(enc->downlink);
+    if (space < headroom + COMM_ENC_FRAMING_LENGTH) {
+        return false;
+    }
+    space -= headroom + COMM_ENC_FRAMING_LENGTH;
+
+    // in the common case, there is room even if every body byte needs escaping, so no separate estimation pass over
+    // the body is needed. otherwise, count the escapes to find out whether the packet still fits.
+    return in->data_len * 2 <= space || comm_enc_estimate_length(in->data_bytes, in->data_len) <= space;
+}
 
-    if (!pipe_sender_reserve(enc->downlink, expected_length)) {
+bool comm_enc_encode_headroom(comm_enc_t *enc, comm_packet_t *in, size_t headroom) {
+    if (!comm_enc_fits(enc, in, headroom)) {
         return false;
     }
 
@@ -184,19 +218,18 @@ bool comm_enc_encode(comm_enc_t *enc, comm_packet_t *in) {
         htobe32((uint32_t) (in->timestamp_ns >> 32)),
         htobe32((uint32_t) (in->timestamp_ns >> 0)),
     };
-    uint32_t crc;
+    const z_crc_t *crc_table = get_crc_table();
+    uint32_t crc_register = comm_crc32_start();
 
     // encode header fields
-    comm_enc_write_escaped(enc, (uint8_t*) fields, sizeof(fields));
-    crc = crc32(0, (uint8_t*) fields, sizeof(fields));
+    crc_register = comm_enc_write_escaped(enc, crc_table, crc_register, (uint8_t*) fields, sizeof(fields));
 
     // encode body
-    comm_enc_write_escaped(enc, in->data_bytes, in->data_len);
-    crc = crc32(crc, in->data_bytes, in->data_len);
+    crc_register = comm_enc_write_escaped(enc, crc_table, crc_register, in->data_bytes, in->data_len);
 
     // encode trailing CRC
-    crc = htobe32(crc);
-    comm_enc_write_escaped(enc, (uint8_t*) &crc, sizeof(crc));
+    uint32_t crc = htobe32(comm_crc32_finish(crc_register));
+    comm_enc_write_escaped(enc, crc_table, comm_crc32_start(), (uint8_t*) &crc, sizeof(crc));
 
     // end of packet
     pipe_sender_write_byte(enc->downlink, BYTE_ESCAPE);
@@ -7,49 +7,95 @@
 #include <flight/command.h>
 #include <flight/telemetry.h>
 
+static cmd_endpoint_t *command_dispatch_lookup(cmd_system_t *cs, uint32_t cid) {
+    // the slot may hold a different command's endpoint, because unknown command IDs can index any slot.
+    cmd_endpoint_t *ce = cs->dispatch[COMMAND_DISPATCH_INDEX(cid)];
+    if (ce != NULL && ce->cid == cid) {
+        return ce;
+    }
+    return NULL;
+}
+
+static bool command_enqueue(cmd_endpoint_t *ce, uint8_t replica_id, struct cmd_queued *command) {
+    struct cmd_queued *entry = circ_buf_write_peek(ce->queues[replica_id], 0);
+    if (entry == NULL) {
+        return false;
+    }
+    *entry = *command;
+    circ_buf_write_done(ce->queues[replica_id], 1);
+    return true;
+}
+
 void command_execution_clip(cmd_replica_t *cr) {
-    assert(cr != NULL && cr->system != NULL && cr->system->endpoints != NULL && cr->decoder != NULL);
+    assert(cr != NULL && cr->system != NULL && cr->system->dispatch != NULL && cr->decoder != NULL);
+    assert(cr->mut != NULL);
 
     if (clip_is_restart()) {
         comm_dec_reset(cr->decoder);
+        cr->mut->stalled_endpoint = NULL;
+        for (size_t i = 0; i < COMMAND_DISPATCH_SLOTS; i++) {
+            if (cr->system->dispatch[i] != NULL) {
+                circ_buf_reset(cr->system->dispatch[i]->queues[cr->replica_id]);
+            }
+        }
     }
 
     comm_dec_prepare(cr->decoder);
     tlm_txn_t telem;
     telemetry_prepare(&telem, cr->system->telemetry, cr->replica_id);
 
-    // only process one command per epoch
-    comm_packet_t packet;
-    bool has_command = comm_dec_decode(cr->decoder, &packet);
+    // a command left over from a previous epoch goes first, so that commands reach each endpoint in uplink order.
+    if (cr->mut->stalled_endpoint != NULL
+            && command_enqueue(cr->mut->stalled_endpoint, cr->replica_id, &cr->mut->stalled_command)) {
+        cr->mut->stalled_endpoint = NULL;
+    }
 
-    if (has_command) {
+    // decode a bounded burst of commands, sorting each into the queue of the endpoint it's aimed at.
+    comm_packet_t packet;
+    for (size_t decoded = 0; decoded < COMMAND_MAX_PER_EPOCH && cr->mut->stalled_endpoint == NULL
+                             && comm_dec_decode(cr->decoder, &packet); decoded++) {
         // confirm reception
         tlm_cmd_received(&telem, packet.timestamp_ns, packet.cmd_tlm_id);
-    }
 
-    // search through endpoints for a match, and service the ducts while we're at it.
-    bool matched = false;
-    for (size_t i = 0; i < cr->system->num_endpoints; i++) {
-        cmd_endpoint_t *ce = cr->system->endpoints[i];
-        assert(ce != NULL);
-        duct_txn_t txn;
-        duct_send_prepare(&txn, ce->duct, cr->replica_id);
-        if (has_command && packet.cmd_tlm_id == ce->cid && packet.data_len <= COMMAND_MAX_PARAM_LENGTH) {
-            struct cmd_duct_msg duct_msg = {
+        cmd_endpoint_t *ce = command_dispatch_lookup(cr->system, packet.cmd_tlm_id);
+        if (ce == NULL || packet.data_len > COMMAND_MAX_PARAM_LENGTH) {
+            // if we don't recognize the command ID, report that.
+            tlm_cmd_not_recognized(&telem, packet.timestamp_ns, packet.cmd_tlm_id, packet.data_len);
+            continue;
+        }
+
+        struct cmd_queued command = {
+            .data_length = packet.data_len,
+            .message = {
                 .timestamp = packet.timestamp_ns,
                 /* need to populate data using memcpy */
-            };
-            assert(packet.data_len <= sizeof(duct_msg.data));
-            memcpy(duct_msg.data, packet.data_bytes, packet.data_len);
-            duct_send_message(&txn, &duct_msg, sizeof(mission_time_t) + packet.data_len, 0);
-            matched = true;
+            },
+        };
+        assert(packet.data_len <= sizeof(command.message.data));
+        memcpy(command.message.data, packet.data_bytes, packet.data_len);
+        if (!command_enqueue(ce, cr->replica_id, &command)) {
+            // hold onto this command until its endpoint catches up, and stop decoding until then.
+            cr->mut->stalled_endpoint = ce;
+            cr->mut->stalled_command = command;
         }
-        duct_send_commit(&txn);
     }
 
-    if (has_command && !matched) {
-        // if we don't recognize the command ID, report that.
-        tlm_cmd_not_recognized(&telem, packet.timestamp_ns, packet.cmd_tlm_id, packet.data_len);
+    // pass each endpoint the oldest command in its queue, and service the ducts while we're at it.
+    for (size_t i = 0; i < COMMAND_DISPATCH_SLOTS; i++) {
+        cmd_endpoint_t *ce = cr->system->dispatch[i];
+        if (ce == NULL) {
+            continue;
+        }
+        // catches a COMMAND_DISPATCH entry that was given a different command ID than its endpoint
+        assert(COMMAND_DISPATCH_INDEX(ce->cid) == i);
+        duct_txn_t txn;
+        duct_send_prepare(&txn, ce->duct, cr->replica_id);
+        struct cmd_queued *command = circ_buf_read_peek(ce->queues[cr->replica_id], 0);
+        if (command != NULL) {
+            duct_send_message(&txn, &command->message, sizeof(mission_time_t) + command->data_length, 0);
+            circ_buf_read_done(ce->queues[cr->replica_id], 1);
+        }
+        duct_send_commit(&txn);
     }
 
     telemetry_commit(&telem);
@@ -11,9 +11,10 @@ void heartbeat_main_clip(heartbeat_replica_t *h) {
     local_time_t now = timer_epoch_ns();
 
     bool valid = false;
-    struct heartbeat_note *mut_synch = notepad_feedforward(h->mut_synch, &valid);
+    struct heartbeat_note *mut_synch = notepad_feedforward_tracked(h->mut_synch, &valid);
     if (!valid || mut_synch->last_heartbeat_time > now) {
         mut_synch->last_heartbeat_time = now - HEARTBEAT_PERIOD;
+        notepad_mark_dirty(h->mut_synch, &mut_synch->last_heartbeat_time, sizeof(mut_synch->last_heartbeat_time));
     }
 
     tlm_txn_t telem;
@@ -27,6 +28,7 @@ void heartbeat_main_clip(heartbeat_replica_t *h) {
         watchdog_ok = true;
 
         mut_synch->last_heartbeat_time = now;
+        notepad_mark_dirty(h->mut_synch, &mut_synch->last_heartbeat_time, sizeof(mut_synch->last_heartbeat_time));
     }
 
     watchdog_indicate(h->aspect, h->replica_id, watchdog_ok);
@@ -25,19 +25,13 @@ enum {
     LATCHING_DELAY_NS = 15 * 1000 * 1000, // wait 15 ms before checking for reading completion
 };
 
-static void magnetometer_telem_iterator_fetch(void *mr_opaque, size_t index, tlm_mag_reading_t *reading_out) {
-    magnetometer_replica_t *mr = (magnetometer_replica_t *) mr_opaque;
-    assert(mr != NULL && reading_out != NULL);
-
-    tlm_mag_reading_t *reading = circ_buf_read_peek(mr->readings, index);
-    assert(reading != NULL);
-    *reading_out = *reading;
-}
-
 void magnetometer_clip(magnetometer_replica_t *mr) {
     assert(mr != NULL);
 
     local_time_t now = timer_epoch_ns();
+    // every mission timestamp this epoch comes from the same vote, so readings and their bounds stay consistent.
+    clock_snapshot_t clock;
+    clock_snapshot_take(&clock);
 
     bool valid = false;
     struct magnetometer_note *synch = notepad_feedforward(mr->synch, &valid);
@@ -108,7 +102,7 @@ void magnetometer_clip(magnetometer_replica_t *mr) {
             if (registers[0] == LATCH_OFF) {
                 tlm_mag_reading_t *reading = circ_buf_write_peek(mr->readings, 0);
                 if (reading != NULL) {
-                    reading->reading_time = clock_mission_adjust(synch->actual_reading_time);
+                    reading->reading_time = clock_snapshot_adjust(&clock, synch->actual_reading_time);
                     reading->mag_x = registers[REG_X - REG_LATCH];
                     reading->mag_y = registers[REG_Y - REG_LATCH];
                     reading->mag_z = registers[REG_Z - REG_LATCH];
@@ -140,11 +134,12 @@ void magnetometer_clip(magnetometer_replica_t *mr) {
     }
 
     if ((synch->state == MS_INACTIVE || synch->state == MS_DEACTIVATING
-            || (synch->state == MS_UNKNOWN && clock_is_calibrated())) && synch->should_be_powered) {
+            || (synch->state == MS_UNKNOWN && clock_snapshot_is_calibrated(&clock))) && synch->should_be_powered) {
         debugf(DEBUG, "Turning on magnetometer power...");
         synch->state = MS_ACTIVATING;
     } else if ((synch->state == MS_ACTIVATING || synch->state == MS_ACTIVE
-                    || (synch->state == MS_UNKNOWN && clock_is_calibrated())) && !synch->should_be_powered) {
+                    || (synch->state == MS_UNKNOWN && clock_snapshot_is_calibrated(&clock)))
+                && !synch->should_be_powered) {
         debugf(DEBUG, "Turning off magnetometer power...");
         synch->state = MS_DEACTIVATING;
     } else if (synch->state == MS_ACTIVE && timer_epoch_ns() >= synch->next_reading_time) {
@@ -197,22 +192,26 @@ void magnetometer_clip(magnetometer_replica_t *mr) {
         // there's room in the telemetry buffer to actually transmit data.
         if (now >= synch->last_telem_time + (uint64_t) 5500 * CLOCK_NS_PER_MS && telemetry_can_send(&telem_synch)) {
             size_t write_count = downlink_count;
-            mission_time_t latest_time = clock_mission_adjust(now);
-            if (write_count > TLM_MAX_MAG_READINGS_PER_MAP) {
-                write_count = TLM_MAX_MAG_READINGS_PER_MAP;
+            mission_time_t latest_time = clock_snapshot_adjust(&clock, now);
+            if (write_count > MAGNETOMETER_MAX_READINGS_PER_MAP) {
+                write_count = MAGNETOMETER_MAX_READINGS_PER_MAP;
                 tlm_mag_reading_t *reading = circ_buf_read_peek(mr->readings, write_count);
                 assert(reading != NULL);
                 latest_time = reading->reading_time - 1;
             } else if ((synch->state == MS_LATCHED_ON || synch->state == MS_TAKING_READING)
                             && latest_time >= synch->actual_reading_time) {
-                latest_time = clock_mission_adjust(synch->actual_reading_time) - 1;
+                latest_time = clock_snapshot_adjust(&clock, synch->actual_reading_time) - 1;
             }
             mission_time_t earliest_time = synch->earliest_time;
             if (!synch->earliest_time_is_mission_time) {
-                earliest_time = clock_mission_adjust(earliest_time);
+                earliest_time = clock_snapshot_adjust(&clock, earliest_time);
             }
-            tlm_mag_readings_map(&telem_synch, earliest_time, latest_time,
-                                 write_count, magnetometer_telem_iterator_fetch, (void *) mr);
+            // hand the readings over directly from the circular buffer, without copying them out one at a time
+            assert(circ_buf_elem_size(mr->readings) == sizeof(tlm_mag_reading_t));
+            circ_span_t spans[2];
+            size_t num_spans = circ_buf_read_peek_spans(mr->readings, write_count, spans);
+            tlm_mag_readings_map(&telem_synch, earliest_time, latest_time, spans, num_spans,
+                                 MAGNETOMETER_DELTA_ENCODING);
             circ_buf_read_done(mr->readings, write_count);
             synch->earliest_time = latest_time + 1;
             synch->earliest_time_is_mission_time = true;
@@ -0,0 +1,35 @@
+#include <hal/debug.h>
+#include <flight/profiler.h>
+#include <flight/telemetry.h>
+
+enum {
+    // report one partition every 100 milliseconds, so that the profile costs very little downlink bandwidth
+    PROFILER_PERIOD = 100 * CLOCK_NS_PER_MS,
+};
+
+void profiler_clip(profiler_t *p) {
+    assert(p != NULL);
+    local_time_t now = timer_epoch_ns();
+
+    if (clip_is_restart() || p->mut->last_report_time > now) {
+        p->mut->next_partition = 0;
+        p->mut->last_report_time = now;
+    }
+
+    tlm_txn_t telem;
+    telemetry_prepare(&telem, p->telemetry, 0);
+
+    if (now >= p->mut->last_report_time + PROFILER_PERIOD) {
+        profile_summary_t summary;
+        if (!clip_profile_summary(p->mut->next_partition, &summary, NULL)) {
+            p->mut->next_partition = 0;
+            bool ok = clip_profile_summary(p->mut->next_partition, &summary, NULL);
+            assert(ok);
+        }
+        tlm_clip_profile(&telem, p->mut->next_partition, &summary);
+        p->mut->next_partition++;
+        p->mut->last_report_time = now;
+    }
+
+    telemetry_commit(&telem);
+}
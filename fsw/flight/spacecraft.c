@@ -9,6 +9,7 @@
 #include <flight/heartbeat.h>
 #include <flight/magnetometer.h>
 #include <flight/pingback.h>
+#include <flight/profiler.h>
 #include <flight/radio.h>
 #include <flight/telemetry.h>
 
@@ -132,6 +133,8 @@ HEARTBEAT_REGISTER(sc_heart);
 
 PINGBACK_REGISTER(sc_pingback);
 
+PROFILER_REGISTER(sc_profiler);
+
 SYSTEM_MAINTENANCE_REGISTER()
 
 COMMAND_SYSTEM_REGISTER(sc_cmd, sc_uplink_pipe, {
@@ -145,6 +148,7 @@ TELEMETRY_SYSTEM_REGISTER(sc_telemetry, sc_downlink_pipe, {
     CLOCK_TELEMETRY(sc_clock)
     PINGBACK_TELEMETRY(sc_pingback)
     HEARTBEAT_TELEMETRY(sc_heart)
+    PROFILER_TELEMETRY(sc_profiler)
 });
 
 WATCHDOG_REGISTER(sc_watchdog, {
@@ -163,6 +167,7 @@ SCHEDULE_PARTITION_ORDER() {
     CLOCK_SCHEDULE(sc_clock)
     PINGBACK_SCHEDULE(sc_pingback)
     HEARTBEAT_SCHEDULE(sc_heart)
+    PROFILER_SCHEDULE(sc_profiler)
     TELEMETRY_SCHEDULE(sc_telemetry)
     RADIO_DOWN_SCHEDULE(sc_radio)
     SWITCH_SCHEDULE(fce_vout)
@@ -16,8 +16,10 @@ enum {
     PONG_TID                  = 0x01000005,
     CLOCK_CALIBRATED_TID      = 0x01000006,
     HEARTBEAT_TID             = 0x01000007,
+    CLIP_PROFILE_TID          = 0x01000008,
     MAG_PWR_STATE_CHANGED_TID = 0x02000001,
     MAG_READINGS_ARRAY_TID    = 0x02000002,
+    MAG_READINGS_DELTA_TID    = 0x02000003,
 };
 
 void telemetry_prepare(tlm_txn_t *txn, tlm_endpoint_t *ep, uint8_t sender_id) {
@@ -66,21 +68,191 @@ static void telemetry_small_submit(tlm_txn_t *txn, uint32_t telemetry_id, void *
     }
 }
 
+static tlm_sync_t *telemetry_sender_scratch(tlm_txn_t *txn) {
+    return (tlm_sync_t *) (txn->ep->sender_scratch + txn->ep->sender_stride * txn->replica_id);
+}
+
+// the returned buffer has room for the endpoint's maximum record size, as passed to TELEMETRY_SYNC_REGISTER.
 static uint8_t *telemetry_large_start(tlm_txn_t *txn, uint32_t telemetry_id) {
     assert(txn != NULL && txn->ep != NULL);
     assert(telemetry_can_send(txn) && txn->ep->is_synchronous);
-    tlm_sync_t *scratch = &txn->ep->sender_scratch[txn->replica_id];
+    tlm_sync_t *scratch = telemetry_sender_scratch(txn);
     scratch->telemetry_id = telemetry_id;
     return scratch->data_bytes;
 }
 
 static void telemetry_large_submit(tlm_txn_t *txn, size_t data_len) {
     assert(txn != NULL);
-    assert(data_len <= TLM_MAX_SYNC_SIZE && txn->ep->is_synchronous);
-    tlm_sync_t *scratch = &txn->ep->sender_scratch[txn->replica_id];
+    assert(txn->ep->is_synchronous && data_len <= txn->ep->sync_max_size);
+    tlm_sync_t *scratch = telemetry_sender_scratch(txn);
     pipe_send_message(&txn->sync_txn, scratch, offsetof(tlm_sync_t, data_bytes) + data_len, timer_epoch_ns());
 }
 
+// how much of the downlink each priority class may use. classes are serviced in priority order each epoch, so the
+// headroom keeps lower classes from filling the buffer that higher classes will need in later epochs, and the budget
+// keeps any one class from taking the entire buffer within a single epoch.
+static const struct tlm_class_policy {
+    size_t headroom;     // bytes of downlink buffer that must remain free after encoding a packet of this class
+    size_t epoch_budget; // bytes of packets that may be started by this class in a single epoch
+} tlm_class_policy[TLM_PRIORITY_COUNT] = {
+    [TLM_PRIORITY_CRITICAL] = { .headroom = 0,                   .epoch_budget = COMM_SCRATCH_SIZE     },
+    [TLM_PRIORITY_NORMAL]   = { .headroom = TLM_HEADROOM_NORMAL, .epoch_budget = COMM_SCRATCH_SIZE / 4 },
+    [TLM_PRIORITY_BULK]     = { .headroom = TLM_HEADROOM_BULK,   .epoch_budget = COMM_SCRATCH_SIZE / 2 },
+};
+
+typedef enum {
+    TLM_ENCODE_DONE,
+    TLM_ENCODE_OVER_BUDGET, // held back by its class's budget or headroom, although the downlink buffer had room
+    TLM_ENCODE_FULL,        // the downlink buffer had no room for the packet at all
+} tlm_encode_result_t;
+
+static tlm_encode_result_t telemetry_encode(tlm_replica_t *ts, tlm_priority_t priority, size_t *spent,
+                                            comm_packet_t *packet) {
+    assert(ts != NULL && spent != NULL && packet != NULL && priority < TLM_PRIORITY_COUNT);
+    const struct tlm_class_policy *policy = &tlm_class_policy[priority];
+
+    if (*spent >= policy->epoch_budget) {
+        return TLM_ENCODE_OVER_BUDGET;
+    }
+    if (!comm_enc_encode_headroom(ts->comm_encoder, packet, policy->headroom)) {
+        // only check this once encoding has failed, so that the common case doesn't need a second pass
+        if (policy->headroom > 0 && comm_enc_fits(ts->comm_encoder, packet, 0)) {
+            return TLM_ENCODE_OVER_BUDGET;
+        }
+        return TLM_ENCODE_FULL;
+    }
+    *spent += COMM_ENC_FRAMING_LENGTH + packet->data_len;
+    return TLM_ENCODE_DONE;
+}
+
+static bool telemetry_sync_transmit(tlm_replica_t *ts, const clock_snapshot_t *clock, tlm_priority_t priority,
+                                    size_t *spent, const tlm_sync_t *sync_data, size_t length,
+                                    local_time_t timestamp) {
+    // fill in telemetry packet
+    comm_packet_t packet = {
+        .cmd_tlm_id = sync_data->telemetry_id,
+        .timestamp_ns = clock_snapshot_adjust(clock, timestamp),
+        .data_len = length - offsetof(tlm_sync_t, data_bytes),
+        .data_bytes = sync_data->data_bytes,
+    };
+    // TODO: better handling of the cases where the pipe or duct receive length is less than header length
+    assert(packet.data_len <= TLM_MAX_SYNC_SIZE);
+
+    debugf(TRACE, "[%u] Transmitting synchronous telemetry, timestamp=" TIMEFMT,
+           ts->replica_id, TIMEARG(packet.timestamp_ns));
+
+    // transmit this packet
+    tlm_encode_result_t result = telemetry_encode(ts, priority, spent, &packet);
+    if (result == TLM_ENCODE_OVER_BUDGET) {
+        // expected whenever higher-priority telemetry is using the downlink, so not worth a warning
+        debugf(DEBUG, "[%u] Deferred synchronous telemetry to stay within class budget... will try again.",
+               ts->replica_id);
+        return false;
+    } else if (result == TLM_ENCODE_FULL) {
+        debugf(WARNING, "[%u] Deferred synchronous telemetry due to full buffer... will try again.", ts->replica_id);
+        return false;
+    }
+
+    debugf(TRACE, "[%u] Transmitted synchronous telemetry.", ts->replica_id);
+    return true;
+}
+
+// transmit any asynchronous telemetry, and record how many we have to drop. returns true if anything was transmitted.
+static bool telemetry_pump_async(tlm_replica_t *ts, const clock_snapshot_t *clock, tlm_priority_t priority,
+                                 size_t *spent, tlm_registration_replica_t *r) {
+    bool transmitted = false;
+
+    duct_txn_t txn;
+    duct_receive_prepare(&txn, r->async_duct, ts->replica_id);
+    const uint8_t *message_bytes = NULL;
+    size_t length = 0;
+    local_time_t timestamp = 0;
+    // encode directly out of the duct; the message stays valid until the receive is committed
+    while ((length = duct_receive_borrow(&txn, &message_bytes, &timestamp)) > 0) {
+        const tlm_async_t *message = (const tlm_async_t *) message_bytes;
+        // fill in telemetry packet
+        comm_packet_t packet = {
+            .cmd_tlm_id = message->telemetry_id,
+            .timestamp_ns = clock_snapshot_adjust(clock, timestamp),
+            .data_len = length - offsetof(tlm_async_t, data_bytes),
+            .data_bytes = message->data_bytes,
+        };
+        assert(packet.data_len <= TLM_MAX_ASYNC_SIZE);
+
+        debugf(TRACE, "[%u] Transmitting async telemetry, timestamp=" TIMEFMT,
+               ts->replica_id, TIMEARG(packet.timestamp_ns));
+
+        // transmit this packet
+        tlm_encode_result_t result = telemetry_encode(ts, priority, spent, &packet);
+        if (result == TLM_ENCODE_DONE) {
+            transmitted = true;
+
+            debugf(TRACE, "[%u] Transmitted async telemetry.", ts->replica_id);
+        } else {
+            if (result == TLM_ENCODE_OVER_BUDGET) {
+                debugf(DEBUG, "[%u] Failed to transmit async telemetry within class budget.", ts->replica_id);
+            } else {
+                debugf(WARNING, "[%u] Failed to transmit async telemetry due to full buffer.", ts->replica_id);
+            }
+            ts->mut->async_dropped[priority]++;
+        }
+    }
+    duct_receive_commit(&txn);
+
+    return transmitted;
+}
+
+// transmit any synchronous telemetry if we can, and buffer the rest for later epochs.
+static void telemetry_pump_sync(tlm_replica_t *ts, const clock_snapshot_t *clock, tlm_priority_t priority,
+                                size_t *spent, tlm_registration_replica_t *r) {
+    pipe_txn_t txn;
+    pipe_receive_prepare(&txn, r->sync_pipe, ts->replica_id);
+
+    circ_buf_t *circ = r->receiver_scratch;
+    tlm_sync_slot_t *slot;
+    assert(sizeof(*slot) + pipe_message_size(r->sync_pipe) <= circ_buf_elem_size(circ));
+
+    // first: as long as nothing is backlogged, transmit telemetry straight out of the pipe without buffering it
+    const uint8_t *message_bytes = NULL;
+    size_t length = 0;
+    local_time_t timestamp = 0;
+    while (
+        circ_buf_read_avail(circ) == 0
+        && (length = pipe_receive_borrow(&txn, &message_bytes, &timestamp)) > 0
+    ) {
+        if (!telemetry_sync_transmit(ts, clock, priority, spent, (const tlm_sync_t *) message_bytes, length,
+                                     timestamp)) {
+            // stash it for a later epoch; this is guaranteed to fit, because the buffer is empty.
+            slot = circ_buf_write_peek(circ, 0);
+            assert(slot != NULL);
+            slot->data_length = length;
+            slot->timestamp = timestamp;
+            memcpy(slot->sync_data, message_bytes, length);
+            circ_buf_write_done(circ, 1);
+        }
+    }
+
+    // second: pull any remaining telemetry from endpoint into the circular buffer
+    while (
+        (slot = circ_buf_write_peek(circ, 0)) != NULL
+        && (slot->data_length = pipe_receive_message(&txn, slot->sync_data, &slot->timestamp)) > 0
+    ) {
+        circ_buf_write_done(circ, 1);
+    }
+
+    // third: attempt to transmit as much buffered telemetry as we can
+    while ((slot = circ_buf_read_peek(circ, 0)) != NULL) {
+        if (!telemetry_sync_transmit(ts, clock, priority, spent, (const tlm_sync_t *) slot->sync_data,
+                                     slot->data_length, slot->timestamp)) {
+            break;
+        }
+        circ_buf_read_done(circ, 1);
+    }
+
+    // fourth: tell the endpoint how much data we're ready to receive
+    pipe_receive_commit(&txn, circ_buf_write_avail(circ));
+}
+
 void telemetry_pump(tlm_replica_t *ts) {
     assert(ts != NULL && ts->mut != NULL && ts->registrations != NULL && ts->replica_id < TELEMETRY_REPLICAS);
 
@@ -99,126 +271,67 @@ void telemetry_pump(tlm_replica_t *ts) {
 
     comm_enc_prepare(ts->comm_encoder);
 
+    // vote on the clock calibration once, and timestamp everything downlinked this epoch from that result.
+    clock_snapshot_t clock;
+    clock_snapshot_take(&clock);
+
     // stage 1: downlink any reports of dropped telemetry
-    if (ts->mut->async_dropped > 0) {
+    bool any_dropped = false;
+    for (tlm_priority_t priority = 0; priority < TLM_PRIORITY_COUNT; priority++) {
+        if (ts->mut->async_dropped[priority] > 0) {
+            any_dropped = true;
+        }
+    }
+    if (any_dropped) {
         // if we've been losing data from our ring buffer, report that!
 
         // convert to big-endian
-        uint32_t drop_count = htobe32(ts->mut->async_dropped);
+        uint32_t drop_counts[TLM_PRIORITY_COUNT];
+        for (tlm_priority_t priority = 0; priority < TLM_PRIORITY_COUNT; priority++) {
+            drop_counts[priority] = htobe32(ts->mut->async_dropped[priority]);
+        }
 
         // fill in telemetry packet
         comm_packet_t packet = {
             .cmd_tlm_id = TLM_DROPPED_TID,
-            .timestamp_ns = clock_mission_adjust(timer_epoch_ns()),
-            .data_len = sizeof(drop_count),
-            .data_bytes = (uint8_t*) &drop_count,
+            .timestamp_ns = clock_snapshot_adjust(&clock, timer_epoch_ns()),
+            .data_len = sizeof(drop_counts),
+            .data_bytes = (uint8_t*) drop_counts,
         };
 
         // transmit this packet
         if (comm_enc_encode(ts->comm_encoder, &packet)) {
-            debugf(CRITICAL, "[%u] Telemetry dropped: MessagesLost=%u", ts->replica_id, drop_count);
+            debugf(CRITICAL, "[%u] Telemetry dropped: CriticalLost=%u NormalLost=%u BulkLost=%u", ts->replica_id,
+                   ts->mut->async_dropped[TLM_PRIORITY_CRITICAL], ts->mut->async_dropped[TLM_PRIORITY_NORMAL],
+                   ts->mut->async_dropped[TLM_PRIORITY_BULK]);
             // if successful, mark that we downlinked this information.
-            ts->mut->async_dropped = 0;
+            for (tlm_priority_t priority = 0; priority < TLM_PRIORITY_COUNT; priority++) {
+                ts->mut->async_dropped[priority] = 0;
+            }
         }
     }
 
     bool watchdog_ok = false;
 
-    // stage 2: transmit any asynchronous telemetry, and record how many we have to drop
-    for (size_t i = 0; i < ts->num_registrations; i++) {
-        tlm_registration_replica_t *r = &ts->registrations[i]->replicas[ts->replica_id];
-
-        // handle synchronous telemetry later
-        if (r->is_synchronous) {
-            continue;
-        }
+    // stage 2: transmit telemetry one priority class at a time, so that lower classes only get what's left over.
+    for (tlm_priority_t priority = 0; priority < TLM_PRIORITY_COUNT; priority++) {
+        size_t spent = 0;
+        for (size_t i = 0; i < ts->num_registrations; i++) {
+            if (ts->registrations[i]->priority != priority) {
+                continue;
+            }
+            tlm_registration_replica_t *r = &ts->registrations[i]->replicas[ts->replica_id];
 
-        tlm_async_t message;
-        duct_txn_t txn;
-        duct_receive_prepare(&txn, r->async_duct, ts->replica_id);
-        size_t length = 0;
-        local_time_t timestamp = 0;
-        while ((length = duct_receive_message(&txn, &message, &timestamp)) > 0) {
-            // fill in telemetry packet
-            comm_packet_t packet = {
-                .cmd_tlm_id = message.telemetry_id,
-                .timestamp_ns = clock_mission_adjust(timestamp),
-                .data_len = length - offsetof(tlm_async_t, data_bytes),
-                .data_bytes = (uint8_t*) message.data_bytes,
-            };
-            assert(packet.data_len <= TLM_MAX_ASYNC_SIZE);
-
-            debugf(TRACE, "[%u] Transmitting async telemetry, timestamp=" TIMEFMT,
-                   ts->replica_id, TIMEARG(packet.timestamp_ns));
-
-            // transmit this packet
-            if (comm_enc_encode(ts->comm_encoder, &packet)) {
+            if (r->is_synchronous) {
+                telemetry_pump_sync(ts, &clock, priority, &spent, r);
+            } else if (telemetry_pump_async(ts, &clock, priority, &spent, r)) {
                 watchdog_ok = true;
-
-                debugf(TRACE, "[%u] Transmitted async telemetry.", ts->replica_id);
-            } else {
-                debugf(WARNING, "[%u] Failed to transmit async telemetry due to full buffer.", ts->replica_id);
-                ts->mut->async_dropped++;
             }
         }
-        duct_receive_commit(&txn);
     }
 
     watchdog_indicate(ts->aspect, ts->replica_id, watchdog_ok);
 
-    // stage 3: transmit any synchronous telemetry if we can
-    for (size_t i = 0; i < ts->num_registrations; i++) {
-        tlm_registration_replica_t *r = &ts->registrations[i]->replicas[ts->replica_id];
-
-        // already handled asynchronous telemetry
-        if (!r->is_synchronous) {
-            continue;
-        }
-
-        // first: pull telemetry from endpoint into the circular buffer
-        pipe_txn_t txn;
-        pipe_receive_prepare(&txn, r->sync_pipe, ts->replica_id);
-
-        circ_buf_t *circ = r->receiver_scratch;
-        tlm_sync_slot_t *slot;
-        assert(sizeof(*slot) == circ_buf_elem_size(circ));
-        while (
-            (slot = circ_buf_write_peek(circ, 0)) != NULL
-            && (slot->data_length = pipe_receive_message(&txn, &slot->sync_data, &slot->timestamp)) > 0
-        ) {
-            circ_buf_write_done(circ, 1);
-        }
-
-        // second: attempt to transmit as much telemetry as we can
-        while ((slot = circ_buf_read_peek(circ, 0)) != NULL) {
-            // fill in telemetry packet
-            comm_packet_t packet = {
-                .cmd_tlm_id = slot->sync_data.telemetry_id,
-                .timestamp_ns = clock_mission_adjust(slot->timestamp),
-                .data_len = slot->data_length - offsetof(tlm_sync_t, data_bytes),
-                .data_bytes = (uint8_t*) slot->sync_data.data_bytes,
-            };
-            // TODO: better handling of the cases where the pipe or duct receive length is less than header length
-            assert(packet.data_len <= TLM_MAX_SYNC_SIZE);
-
-            debugf(TRACE, "[%u] Transmitting synchronous telemetry, timestamp=" TIMEFMT,
-                   ts->replica_id, TIMEARG(packet.timestamp_ns));
-
-            // transmit this packet
-            if (!comm_enc_encode(ts->comm_encoder, &packet)) {
-                debugf(WARNING, "[%u] Failed to transmit synchronous telemetry due to full buffer... will try again.",
-                       ts->replica_id);
-                break;
-            }
-
-            debugf(TRACE, "[%u] Transmitted synchronous telemetry.", ts->replica_id);
-            circ_buf_read_done(circ, 1);
-        }
-
-        // third: tell the endpoint how much data we're ready to receive
-        pipe_receive_commit(&txn, circ_buf_write_avail(circ));
-    }
-
     comm_enc_commit(ts->comm_encoder);
 }
 
@@ -297,6 +410,38 @@ void tlm_heartbeat(tlm_txn_t *txn) {
     telemetry_small_submit(txn, HEARTBEAT_TID, NULL, 0);
 }
 
+static inline uint16_t tlm_saturate_u16(uint32_t value) {
+    return value > UINT16_MAX ? UINT16_MAX : (uint16_t) value;
+}
+
+void tlm_clip_profile(tlm_txn_t *txn, uint32_t partition, const profile_summary_t *summary) {
+    assert(summary != NULL);
+    debugf(DEBUG, "[%u] Clip Profile: Partition=%u Runs=%u Overruns=%u Min=%uns Mean=%uns P99=%uns Max=%uns",
+           txn->replica_id, partition, summary->runs, summary->overruns,
+           summary->min_ns, summary->mean_ns, summary->p99_ns, summary->max_ns);
+
+    // durations are reported in microseconds, saturating, to fit within a single async telemetry message
+    struct {
+        uint8_t  partition;
+        uint32_t runs;
+        uint16_t overruns;
+        uint16_t min_us;
+        uint16_t mean_us;
+        uint16_t p99_us;
+        uint16_t max_us;
+    } __attribute__((packed)) data = {
+        .partition = (uint8_t) partition,
+        .runs      = htobe32(summary->runs),
+        .overruns  = htobe16(tlm_saturate_u16(summary->overruns)),
+        .min_us    = htobe16(tlm_saturate_u16(summary->min_ns / CLOCK_NS_PER_US)),
+        .mean_us   = htobe16(tlm_saturate_u16(summary->mean_ns / CLOCK_NS_PER_US)),
+        .p99_us    = htobe16(tlm_saturate_u16(summary->p99_ns / CLOCK_NS_PER_US)),
+        .max_us    = htobe16(tlm_saturate_u16(summary->max_ns / CLOCK_NS_PER_US)),
+    };
+    static_assert(sizeof(data) <= TLM_MAX_ASYNC_SIZE, "clip profile must fit in async telemetry");
+    telemetry_small_submit(txn, CLIP_PROFILE_TID, &data, sizeof(data));
+}
+
 void tlm_mag_pwr_state_changed(tlm_txn_t *txn, bool power_state) {
     debugf(INFO, "[%u] Magnetometer Power State Changed: PowerState=%d", txn->replica_id, power_state);
 
@@ -308,13 +453,109 @@ void tlm_mag_pwr_state_changed(tlm_txn_t *txn, bool power_state) {
     telemetry_small_submit(txn, MAG_PWR_STATE_CHANGED_TID, &data, sizeof(data));
 }
 
-void tlm_mag_readings_map(tlm_txn_t *txn, uint64_t earliest_time, uint64_t latest_time, size_t fetch_count,
-                          void (*fetch)(void *param, size_t index, tlm_mag_reading_t *out), void *param) {
-    assert(txn != NULL && fetch != NULL);
-    assert(fetch_count >= 1 && fetch_count <= TLM_MAX_MAG_READINGS_PER_MAP);
+// writes a single reading as a fixed 14-byte record, and returns the position just past it.
+static uint8_t *tlm_mag_encode_record(uint8_t *data_bytes, const tlm_mag_reading_t *rd) {
+    uint16_t *out = (uint16_t*) data_bytes;
+
+    *out++ = htobe16((uint16_t) (rd->reading_time >> 48));
+    *out++ = htobe16((uint16_t) (rd->reading_time >> 32));
+    *out++ = htobe16((uint16_t) (rd->reading_time >> 16));
+    *out++ = htobe16((uint16_t) (rd->reading_time >> 0));
+
+    *out++ = htobe16(rd->mag_x);
+    *out++ = htobe16(rd->mag_y);
+    *out++ = htobe16(rd->mag_z);
+
+    assert((uint8_t*) out - data_bytes == TLM_MAG_READING_SIZE);
+    return (uint8_t*) out;
+}
+
+// writes each reading as a fixed 14-byte record. returns the number of bytes written.
+static size_t tlm_mag_encode_raw(uint8_t *data_bytes, const circ_span_t *spans, size_t num_spans) {
+    uint8_t *out = data_bytes;
+    size_t index = 0;
+    for (size_t s = 0; s < num_spans; s++) {
+        const tlm_mag_reading_t *readings = spans[s].elements;
+        for (circ_index_t i = 0; i < spans[s].count; i++, index++) {
+            const tlm_mag_reading_t *rd = &readings[i];
+
+            debugf(DEBUG, "    Readings[%zu]={%"PRIu64", %d, %d, %d}",
+                   index, rd->reading_time, rd->mag_x, rd->mag_y, rd->mag_z);
+
+            out = tlm_mag_encode_record(out, rd);
+        }
+    }
+    return out - data_bytes;
+}
+
+// writes a signed varint in the same form as Go's encoding/binary.PutVarint: zigzag, then 7 bits per byte, low first.
+static uint8_t *tlm_put_varint(uint8_t *out, int64_t value) {
+    uint64_t zigzag = ((uint64_t) value << 1) ^ (uint64_t) (value >> 63);
+    while (zigzag >= 0x80) {
+        *out++ = (uint8_t) (zigzag | 0x80);
+        zigzag >>= 7;
+    }
+    *out++ = (uint8_t) zigzag;
+    return out;
+}
+
+enum {
+    // a reading time delta-of-delta takes at most 10 varint bytes, and each axis delta fits in 17 bits, so 3 bytes.
+    TLM_MAG_DELTA_MAX_ENTRY = 10 + 3 * 3,
+};
+
+// writes the first reading as a fixed record, and each subsequent reading as varints: the change in the interval
+// between reading times, followed by the change in each axis. returns the number of bytes written, or 0 if the result
+// would not fit within 'capacity'.
+static size_t tlm_mag_encode_delta(uint8_t *data_bytes, size_t capacity, const circ_span_t *spans, size_t num_spans) {
+    assert(capacity >= TLM_MAG_READING_SIZE && num_spans >= 1 && spans[0].count >= 1);
+    const tlm_mag_reading_t *last = spans[0].elements;
+    debugf(DEBUG, "    Readings[0]={%"PRIu64", %d, %d, %d}", last->reading_time, last->mag_x, last->mag_y, last->mag_z);
+    size_t length = tlm_mag_encode_record(data_bytes, last) - data_bytes;
+
+    uint64_t last_interval = 0;
+    size_t index = 1;
+    for (size_t s = 0; s < num_spans; s++) {
+        const tlm_mag_reading_t *readings = spans[s].elements;
+        // the first reading has already been written as a fixed record
+        for (circ_index_t i = (s == 0 ? 1 : 0); i < spans[s].count; i++, index++) {
+            const tlm_mag_reading_t *rd = &readings[i];
+
+            debugf(DEBUG, "    Readings[%zu]={%"PRIu64", %d, %d, %d}",
+                   index, rd->reading_time, rd->mag_x, rd->mag_y, rd->mag_z);
+
+            uint8_t entry[TLM_MAG_DELTA_MAX_ENTRY];
+            uint64_t interval = rd->reading_time - last->reading_time;
+            uint8_t *out = tlm_put_varint(entry, (int64_t) (interval - last_interval));
+            out = tlm_put_varint(out, (int32_t) rd->mag_x - last->mag_x);
+            out = tlm_put_varint(out, (int32_t) rd->mag_y - last->mag_y);
+            out = tlm_put_varint(out, (int32_t) rd->mag_z - last->mag_z);
+            assert(out <= entry + sizeof(entry));
+
+            if (length + (out - entry) > capacity) {
+                return 0;
+            }
+            memcpy(data_bytes + length, entry, out - entry);
+            length += out - entry;
+
+            last = rd;
+            last_interval = interval;
+        }
+    }
+    return length;
+}
+
+void tlm_mag_readings_map(tlm_txn_t *txn, uint64_t earliest_time, uint64_t latest_time,
+                          const circ_span_t *spans, size_t num_spans, bool delta_encode) {
+    assert(txn != NULL && spans != NULL && num_spans >= 1 && num_spans <= 2);
+    size_t reading_count = 0;
+    for (size_t s = 0; s < num_spans; s++) {
+        reading_count += spans[s].count;
+    }
+    assert(reading_count >= 1 && TLM_MAG_READINGS_MAP_SIZE(reading_count) <= txn->ep->sync_max_size);
 
     // get the buffer
-    uint8_t *data_bytes = telemetry_large_start(txn, MAG_READINGS_ARRAY_TID);
+    uint8_t *data_bytes = telemetry_large_start(txn, delta_encode ? MAG_READINGS_DELTA_TID : MAG_READINGS_ARRAY_TID);
 
     // set up the header
     struct {
@@ -327,28 +568,24 @@ void tlm_mag_readings_map(tlm_txn_t *txn, uint64_t earliest_time, uint64_t lates
 
     // now fill the rest of the buffer
     debugf(DEBUG, "[%u] Magnetometer Readings Array for " TIMEFMT " to " TIMEFMT ": %zu readings",
-           txn->replica_id, TIMEARG(earliest_time), TIMEARG(latest_time), fetch_count);
+           txn->replica_id, TIMEARG(earliest_time), TIMEARG(latest_time), reading_count);
     memcpy(data_bytes, &header, sizeof(header));
-    uint16_t *out = (uint16_t*) (data_bytes + sizeof(header));
-    for (size_t i = 0; i < fetch_count; i++) {
-        tlm_mag_reading_t rd;
-
-        fetch(param, i, &rd);
-
-        debugf(DEBUG, "    Readings[%zu]={%"PRIu64", %d, %d, %d}",
-               i, rd.reading_time, rd.mag_x, rd.mag_y, rd.mag_z);
-
-        *out++ = htobe16((uint16_t) (rd.reading_time >> 48));
-        *out++ = htobe16((uint16_t) (rd.reading_time >> 32));
-        *out++ = htobe16((uint16_t) (rd.reading_time >> 16));
-        *out++ = htobe16((uint16_t) (rd.reading_time >> 0));
-
-        *out++ = htobe16(rd.mag_x);
-        *out++ = htobe16(rd.mag_y);
-        *out++ = htobe16(rd.mag_z);
+    size_t length = 0;
+    if (delta_encode) {
+        // only worthwhile if it comes out smaller than the fixed-size encoding
+        length = tlm_mag_encode_delta(data_bytes + sizeof(header), reading_count * TLM_MAG_READING_SIZE,
+                                      spans, num_spans);
+        if (length == 0) {
+            debugf(DEBUG, "[%u] Readings too irregular for delta encoding; using fixed-size records instead.",
+                   txn->replica_id);
+            data_bytes = telemetry_large_start(txn, MAG_READINGS_ARRAY_TID);
+        }
+    }
+    if (length == 0) {
+        length = tlm_mag_encode_raw(data_bytes + sizeof(header), spans, num_spans);
     }
-    assert((uint8_t*) out - data_bytes == (ssize_t) (fetch_count * 14 + sizeof(header)));
+    assert(sizeof(header) + length <= TLM_MAG_READINGS_MAP_SIZE(reading_count));
 
     // write the sync record to the ring buffer, and wait for it to be written out to the telemetry stream
-    telemetry_large_submit(txn, (uint8_t*) out - data_bytes);
+    telemetry_large_submit(txn, sizeof(header) + length);
 }
@@ -0,0 +1,10 @@
+#ifndef FSW_BUS_CONFIG_H
+#define FSW_BUS_CONFIG_H
+
+// CONFIG_BUS_RMAP_CRC_SLICES can be set to one of three values:
+//   [1] RMAP CRCs will be computed a single byte at a time, using a single 256-byte table.
+//   [4] RMAP CRCs will be computed four bytes at a time, using four 256-byte tables.
+//   [8] RMAP CRCs will be computed eight bytes at a time, using eight 256-byte tables.
+#define CONFIG_BUS_RMAP_CRC_SLICES 4
+
+#endif /* FSW_BUS_CONFIG_H */
@@ -10,7 +10,14 @@
 #define EXCHANGE_REPLICAS CONFIG_APPLICATION_REPLICAS
 
 enum {
-    MAX_OUTSTANDING_TOKENS = 10,
+    // upper bound on the flow control window either end may grant; must match MaxOutstandingTokens in the simulator.
+    // each exchange grants at most the max flow of its read duct, which is usually much smaller.
+    MAX_OUTSTANDING_TOKENS = 254,
+    // decoder entries (control characters or runs of data characters) budgeted per packet in a receive clip: the
+    // START_PACKET, the body, which may be split across two link buffers, and the END_PACKET.
+    EXCHANGE_DECODE_ENTRIES_PER_PACKET = 4,
+    // additional decoder entries budgeted per receive clip for flow control, keep-alive, and handshake tokens.
+    EXCHANGE_DECODE_ENTRIES_EXTRA = 8,
 };
 
 // custom exchange protocol
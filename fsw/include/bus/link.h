@@ -6,6 +6,9 @@ enum {
     FW_FLAG_VIRTIO    = 1,
     FW_FLAG_FIFO_PROD = 2,
     FW_FLAG_FIFO_CONS = 3,
+    // Linux only: a pair of byte rings in a file mapped by both processes, which poll them from their clips
+    FW_FLAG_SHM_PROD  = 4,
+    FW_FLAG_SHM_CONS  = 5,
 };
 
 typedef struct fw_link_options_st {
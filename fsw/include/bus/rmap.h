@@ -5,14 +5,21 @@
 #include <stdbool.h>
 
 #include <hal/clip.h>
+#include <hal/init.h>
 #include <bus/switch.h>
 
 enum {
     RMAP_MAX_PATH = 12,
     RMAP_MAX_DATA_LEN = 0x00FFFFFF,
+    // upper limit on the number of transactions an RMAP handler may have in flight at once
+    RMAP_MAX_INFLIGHT = 8,
 
     SCRATCH_MARGIN_WRITE = RMAP_MAX_PATH + 4 + RMAP_MAX_PATH + 12 + 1, // for write requests (larger than read)
     SCRATCH_MARGIN_READ = 12 + 1,                                      // for read replies (larger than write)
+
+    // everything in a command before the transaction ID: destination path, four fixed fields, source path, and
+    // source logical address
+    RMAP_HEADER_PREFIX_MAX = RMAP_MAX_PATH + 4 + RMAP_MAX_PATH + 1,
 };
 
 typedef struct {
@@ -47,51 +54,88 @@ typedef enum {
 } rmap_status_t;
 
 typedef struct {
-    uint16_t current_txn_id;
+    uint16_t current_txn_id; // the most recently started transaction
 } rmap_synch_t;
 
+// the part of a command that is the same for every transaction on an endpoint, along with the header CRC state over
+// it. rmap_header_init lays it out at startup, and it is only read afterwards. each replica keeps its own copy, so an
+// upset in one copy only corrupts that replica's commands, which the other replicas outvote.
+typedef struct {
+    uint8_t prefix[RMAP_HEADER_PREFIX_MAX];
+    uint8_t prefix_length;
+    uint8_t flags_offset;
+    uint8_t flags_write;
+    uint8_t flags_read;
+    uint8_t crc_write; // header CRC over the prefix, for a write command
+    uint8_t crc_read;  // same, for a read command
+} rmap_header_t;
+
 typedef const struct {
-    const char *label;
-    duct_t     *rx_duct;
-    duct_t     *tx_duct;
-    uint8_t    *scratch;
-    uint8_t     replica_id;
+    const char    *label;
+    duct_t        *rx_duct;
+    duct_t        *tx_duct;
+    uint8_t       *scratch;
+    rmap_header_t *header;
+    uint8_t        replica_id;
 
     const rmap_addr_t *routing;
 } rmap_replica_t;
 
+typedef struct {
+    const uint8_t *data; // borrowed from the receive duct until rmap_epoch_commit
+    size_t         length;
+    local_time_t   timestamp;
+    bool           claimed;
+} rmap_reply_t;
+
 typedef struct {
     rmap_replica_t *rmap;
     rmap_synch_t *synch;
     duct_txn_t rx_recv_txn;
     duct_txn_t tx_send_txn;
+    // every reply received during this epoch, to be matched against completions by transaction ID
+    rmap_reply_t replies[RMAP_MAX_INFLIGHT];
+    size_t       num_replies;
 } rmap_txn_t;
 
-// maximum flow needed by an RMAP handler is one packet per epoch in each direction (for continuous operation)
+// a single-user RMAP handler needs one packet per epoch in each direction (for continuous operation)
 #define RMAP_MAX_IO_FLOW        1
 
-// a single-user RMAP handler; only one transaction may be in progress at a time.
-// rx is for packets received by the RMAP handler; tx is for packets sent by the RMAP handler.
-macro_define(RMAP_ON_SWITCHES, r_ident, r_replicas, r_switch_in, r_switch_out, r_switch_port, r_routing, r_max_read, r_max_write) {
-    DUCT_REGISTER(symbol_join(r_ident, receive),      SWITCH_REPLICAS, r_replicas, RMAP_MAX_IO_FLOW,
+// an RMAP handler that may start up to r_max_inflight transactions per epoch. replies are matched to requests by
+// transaction ID, so they may be completed in any order. the handler's max IO flow is r_max_inflight.
+macro_define(RMAP_ON_SWITCHES_PIPELINED, r_ident, r_replicas, r_switch_in, r_switch_out, r_switch_port, r_routing,
+                                         r_max_read, r_max_write, r_max_inflight) {
+    static_assert((r_max_inflight) >= 1 && (r_max_inflight) <= RMAP_MAX_INFLIGHT, "invalid RMAP in-flight limit");
+    DUCT_REGISTER(symbol_join(r_ident, receive),      SWITCH_REPLICAS, r_replicas, r_max_inflight,
                   SCRATCH_MARGIN_READ  + r_max_read,  DUCT_SENDER_FIRST);
-    DUCT_REGISTER(symbol_join(r_ident, transmit),     r_replicas, SWITCH_REPLICAS, RMAP_MAX_IO_FLOW,
+    DUCT_REGISTER(symbol_join(r_ident, transmit),     r_replicas, SWITCH_REPLICAS, r_max_inflight,
                   SCRATCH_MARGIN_WRITE + r_max_write, DUCT_SENDER_FIRST);
     SWITCH_PORT_INBOUND(r_switch_out, r_switch_port, symbol_join(r_ident, transmit));
     SWITCH_PORT_OUTBOUND(r_switch_in, r_switch_port, symbol_join(r_ident, receive));
     uint8_t symbol_join(r_ident, scratch)[RMAP_MAX_IO_PACKET(r_max_read, r_max_write)];
     static_repeat(r_replicas, r_replica_id) {
+        rmap_header_t symbol_join(r_ident, header, r_replica_id);
         rmap_replica_t symbol_join(r_ident, replica, r_replica_id) = {
             .label = symbol_str(r_ident),
             .rx_duct = &symbol_join(r_ident, receive),
             .tx_duct = &symbol_join(r_ident, transmit),
             .scratch = symbol_join(r_ident, scratch),
+            .header = &symbol_join(r_ident, header, r_replica_id),
             .replica_id = r_replica_id,
             .routing = &(r_routing),
         };
+        PROGRAM_INIT_PARAM(STAGE_RAW, rmap_header_init, symbol_join(r_ident, r_replica_id),
+                           &symbol_join(r_ident, replica, r_replica_id));
     }
 }
 
+// a single-user RMAP handler; only one transaction may be in progress at a time.
+// rx is for packets received by the RMAP handler; tx is for packets sent by the RMAP handler.
+macro_define(RMAP_ON_SWITCHES, r_ident, r_replicas, r_switch_in, r_switch_out, r_switch_port, r_routing, r_max_read, r_max_write) {
+    RMAP_ON_SWITCHES_PIPELINED(r_ident, r_replicas, r_switch_in, r_switch_out, r_switch_port, r_routing,
+                               r_max_read, r_max_write, RMAP_MAX_IO_FLOW);
+}
+
 macro_define(RMAP_REPLICA_REF, r_ident, r_replica_id) {
     &symbol_join(r_ident, replica, r_replica_id)
 }
@@ -100,6 +144,7 @@ macro_define(RMAP_MAX_IO_PACKET, r_max_read, r_max_write) {
     PP_CONST_MAX(SCRATCH_MARGIN_READ + (r_max_read), SCRATCH_MARGIN_WRITE + (r_max_write))
 }
 
+void rmap_header_init(rmap_replica_t *rmap);
 void rmap_synch_reset(rmap_synch_t *synch);
 
 // must be called every epoch before any uses of RMAP have been made, even if RMAP won't be used.
@@ -107,19 +152,24 @@ void rmap_epoch_prepare(rmap_txn_t *txn, rmap_replica_t *rmap, rmap_synch_t *syn
 // must be called every epoch after all uses of RMAP have been completed, even if RMAP didn't get used.
 void rmap_epoch_commit(rmap_txn_t *txn);
 
-// uses ACKNOWLEDGE | VERIFY | INCREMENT flags
-void rmap_write_start(rmap_txn_t *txn, uint8_t ext_addr, uint32_t main_addr, uint8_t *buffer, size_t length);
+// uses ACKNOWLEDGE | VERIFY | INCREMENT flags. returns the transaction ID to pass to rmap_write_complete_id.
+uint16_t rmap_write_start(rmap_txn_t *txn, uint8_t ext_addr, uint32_t main_addr, uint8_t *buffer, size_t length);
 // this should be called one epoch later, to give the networking infrastructure time to respond
+rmap_status_t rmap_write_complete_id(rmap_txn_t *txn, uint16_t txn_id, local_time_t *ack_timestamp_out);
+// completes the most recently started transaction
 rmap_status_t rmap_write_complete(rmap_txn_t *txn, local_time_t *ack_timestamp_out);
 
-// uses INCREMENT flag
-void rmap_read_start(rmap_txn_t *txn, uint8_t ext_addr, uint32_t main_addr, size_t length);
+// uses INCREMENT flag. returns the transaction ID to pass to rmap_read_complete_id.
+uint16_t rmap_read_start(rmap_txn_t *txn, uint8_t ext_addr, uint32_t main_addr, size_t length);
 // this should be called one epoch later, to give the networking infrastructure time to respond
+rmap_status_t rmap_read_complete_id(rmap_txn_t *txn, uint16_t txn_id,
+                                    uint8_t *buffer, size_t buffer_size, local_time_t *ack_timestamp_out);
+// completes the most recently started transaction
 rmap_status_t rmap_read_complete(rmap_txn_t *txn, uint8_t *buffer, size_t buffer_size, local_time_t *ack_timestamp_out);
 
 // helper functions for main code (defined in rmap_helpers.c)
-uint8_t rmap_crc8(uint8_t *bytes, size_t len);
-uint8_t rmap_crc8_extend(uint8_t previous, uint8_t *bytes, size_t len);
+uint8_t rmap_crc8(const uint8_t *bytes, size_t len);
+uint8_t rmap_crc8_extend(uint8_t previous, const uint8_t *bytes, size_t len);
 void rmap_encode_source_path(uint8_t **out, const rmap_path_t *path);
 
 #endif /* FSW_FAKEWIRE_RMAP_H */
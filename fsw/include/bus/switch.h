@@ -32,31 +32,36 @@ typedef struct {
 // TODO: figure out how to prebuild this structure so that it can be const
 typedef struct {
     switch_port_t ports[SWITCH_PORTS];
+    // indices into ports[] of every port that has been wired up, so that idle ports cost nothing per epoch
+    uint8_t       active_ports[SWITCH_PORTS];
+    uint8_t       num_active_ports;
 
-    size_t scratch_buffer_size;
+    size_t max_packet_size;
 
-    uint8_t routing_table[SWITCH_ROUTES];
+    // indexed directly by destination address, covering both physical ports and logical routes
+    uint8_t routing_table[256];
 } switch_t;
 
 typedef struct {
     switch_t *replica_switch;
-    uint8_t  *scratch_buffer;
     uint8_t   replica_id;
 } switch_replica_t;
 
 void switch_io_clip(const switch_replica_t *sr);
+// called during initialization to record that a port is in use
+void switch_activate_port(switch_t *sw, uint8_t port);
 
 macro_define(SWITCH_REGISTER, v_ident, v_max_buffer) {
     switch_t v_ident = {
         .ports = { { NULL } },
-        .scratch_buffer_size = (v_max_buffer),
+        .active_ports = { 0 },
+        .num_active_ports = 0,
+        .max_packet_size = (v_max_buffer),
         .routing_table = { 0 },
     };
     static_repeat(SWITCH_REPLICAS, switch_replica_id) {
-        uint8_t symbol_join(v_ident, scratch_buffer, switch_replica_id)[v_max_buffer];
         const switch_replica_t symbol_join(v_ident, replica, switch_replica_id) = {
             .replica_switch = &v_ident,
-            .scratch_buffer = symbol_join(v_ident, scratch_buffer, switch_replica_id),
             .replica_id     = switch_replica_id,
         };
         CLIP_REGISTER(symbol_join(v_ident, clip, switch_replica_id), switch_io_clip,
@@ -75,9 +80,10 @@ macro_define(SWITCH_PORT_INBOUND, v_ident, v_port, v_inbound) {
     static_assert(SWITCH_PORT_BASE <= (v_port) && (v_port) < SWITCH_PORT_BASE + SWITCH_PORTS,
                   "switch port must be valid");
     static void symbol_join(v_ident, port, v_port, init_inbound)(void) {
-        assert(duct_message_size(&(v_inbound)) <= v_ident.scratch_buffer_size);
+        assert(duct_message_size(&(v_inbound)) <= v_ident.max_packet_size);
         assert(v_ident.ports[(v_port) - SWITCH_PORT_BASE].inbound == NULL);
         v_ident.ports[(v_port) - SWITCH_PORT_BASE].inbound = &v_inbound;
+        switch_activate_port(&v_ident, v_port);
     }
     PROGRAM_INIT(STAGE_RAW, symbol_join(v_ident, port, v_port, init_inbound))
 }
@@ -90,22 +96,27 @@ macro_define(SWITCH_PORT_OUTBOUND, v_ident, v_port, v_outbound) {
         /* no need to check outbound message size; we can detect if a truncation is necessary! */
         assert(v_ident.ports[(v_port) - SWITCH_PORT_BASE].outbound == NULL);
         v_ident.ports[(v_port) - SWITCH_PORT_BASE].outbound = &v_outbound;
+        switch_activate_port(&v_ident, v_port);
+        /* physical addresses always route to the port of the same number, with the address popped */
+        assert(v_ident.routing_table[v_port] == 0);
+        v_ident.routing_table[v_port] = (v_port) | SWITCH_ROUTE_FLAG_ENABLED | SWITCH_ROUTE_FLAG_POP;
     }
     PROGRAM_INIT(STAGE_RAW, symbol_join(v_ident, port, v_port, init_outbound))
 }
 
 macro_define(SWITCH_ROUTE, v_ident, v_logical_address, v_port, v_address_pop) {
-    static_assert(SWITCH_ROUTE_BASE <= (v_logical_address), "switch route must be valid");
+    static_assert(SWITCH_ROUTE_BASE <= (v_logical_address) && (v_logical_address) <= 255,
+                  "switch route must be valid");
     static_assert(SWITCH_PORT_BASE <= (v_port) && (v_port) < SWITCH_PORT_BASE + SWITCH_PORTS,
                   "switch port must be valid");
     static void symbol_join(v_ident, route, v_logical_address, init)(void) {
-        assert(v_ident.routing_table[(v_logical_address) - SWITCH_ROUTE_BASE] == 0);
+        assert(v_ident.routing_table[v_logical_address] == 0);
         uint8_t route = (v_port) | SWITCH_ROUTE_FLAG_ENABLED;
         if (v_address_pop) {
             route |= SWITCH_ROUTE_FLAG_POP;
         }
         assert((route & SWITCH_ROUTE_PORT_MASK) == (v_port));
-        v_ident.routing_table[(v_logical_address) - SWITCH_ROUTE_BASE] = route;
+        v_ident.routing_table[v_logical_address] = route;
     }
     PROGRAM_INIT(STAGE_RAW, symbol_join(v_ident, route, v_logical_address, init))
 }
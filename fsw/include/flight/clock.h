@@ -50,6 +50,24 @@ static inline mission_time_t clock_timestamp(void) {
     return clock_mission_adjust(timer_now_ns());
 }
 
+// a replica-local copy of the voted calibration. a clip takes one at the start of each invocation and then timestamps
+// from it, which keeps the independence of the vote without repeating it for every record.
+typedef struct {
+    int64_t offset_adj;
+} clock_snapshot_t;
+
+static inline void clock_snapshot_take(clock_snapshot_t *snapshot) {
+    snapshot->offset_adj = clock_offset_adj_vote();
+}
+
+static inline mission_time_t clock_snapshot_adjust(const clock_snapshot_t *snapshot, local_time_t clock_mono) {
+    return clock_mono + snapshot->offset_adj;
+}
+
+static inline bool clock_snapshot_is_calibrated(const clock_snapshot_t *snapshot) {
+    return snapshot->offset_adj != CLOCK_UNCALIBRATED;
+}
+
 // unlike clock_mission_adjust and clock_timestamp, these do not do instant voting; this means that calibration errors
 // may be correlated across modules and replicas, which is acceptable for debugging traces, but not for telemetry!
 static inline mission_time_t clock_mission_adjust_fast(local_time_t clock_mono) {
@@ -9,14 +9,16 @@
 
 enum clock_state {
     CLOCK_IDLE,
-    CLOCK_READ_MAGIC_NUMBER,
-    CLOCK_READ_CURRENT_TIME,
+    CLOCK_READ_MAGIC_NUMBER, // the current time is read alongside the magic number
+    CLOCK_READ_CURRENT_TIME, // only the current time remains to be read
     CLOCK_CALIBRATED,
 };
 
 struct clock_replica_note {
     enum clock_state state;
     rmap_synch_t     rmap_synch;
+    uint16_t         magic_txn_id;
+    uint16_t         time_txn_id;
 };
 
 typedef const struct {
@@ -26,13 +28,16 @@ typedef const struct {
     tlm_endpoint_t *telem;
 } clock_replica_t;
 
+// one RMAP channel, with the magic number and current time reads in flight together
+#define CLOCK_MAX_IO_FLOW       2
+
 void clock_start_clip(clock_replica_t *cr);
 void clock_voter_clip(void);
 
 macro_define(CLOCK_REGISTER, c_ident, c_address, c_switch_in, c_switch_out, c_switch_port) {
-    RMAP_ON_SWITCHES(symbol_join(c_ident, rmap), CLOCK_REPLICAS, c_switch_in, c_switch_out, c_switch_port, c_address,
-                     sizeof(uint64_t), 0);
-    TELEMETRY_ASYNC_REGISTER(symbol_join(c_ident, telemetry), CLOCK_REPLICAS, 1);
+    RMAP_ON_SWITCHES_PIPELINED(symbol_join(c_ident, rmap), CLOCK_REPLICAS, c_switch_in, c_switch_out, c_switch_port,
+                               c_address, sizeof(uint64_t), 0, CLOCK_MAX_IO_FLOW);
+    TELEMETRY_ASYNC_REGISTER(symbol_join(c_ident, telemetry), CLOCK_REPLICAS, 1, TLM_PRIORITY_NORMAL);
     NOTEPAD_REGISTER(symbol_join(c_ident, notepad), CLOCK_REPLICAS, sizeof(struct clock_replica_note));
     static_repeat(CLOCK_REPLICAS, c_replica_id) {
         clock_replica_t symbol_join(c_ident, replica, c_replica_id) = {
@@ -58,9 +63,6 @@ macro_define(CLOCK_TELEMETRY, c_ident) {
     TELEMETRY_ENDPOINT_REF(symbol_join(c_ident, telemetry))
 }
 
-// one RMAP channel
-#define CLOCK_MAX_IO_FLOW       RMAP_MAX_IO_FLOW
-
 // largest packet size that the switch needs to be able to route
 #define CLOCK_MAX_IO_PACKET                                                                                           \
     RMAP_MAX_IO_PACKET(sizeof(uint64_t), 0)
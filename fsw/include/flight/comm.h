@@ -10,6 +10,13 @@
 
 enum {
     COMM_SCRATCH_SIZE = 0x1000,
+
+    // worst-case length of everything comm_enc_encode writes around the body: start and end markers, plus the header
+    // fields and the CRC with every byte escaped.
+    COMM_ENC_FRAMING_LENGTH = 2 + sizeof(uint32_t) * 4 * 2 + sizeof(uint32_t) * 2 + 2,
+    // the largest body that comm_enc_encode can accept, since it reserves room for every body byte to be escaped.
+    // (comm_enc_encode_headroom accepts correspondingly less, depending on the headroom requested.)
+    COMM_ENC_MAX_DATA_LENGTH = (COMM_SCRATCH_SIZE - COMM_ENC_FRAMING_LENGTH) / 2,
 };
 
 typedef struct {
@@ -24,6 +31,7 @@ typedef struct {
     uint8_t   decode_buffer[COMM_SCRATCH_SIZE];
     bool      decode_in_progress;
     size_t    decode_offset;
+    uint32_t  decode_crc;
     uint32_t  err_count;
 } comm_dec_t;
 
@@ -38,6 +46,7 @@ macro_define(COMM_DEC_REGISTER, d_ident, d_uplink, d_replica) {
         .decode_buffer = { 0 },
         .decode_in_progress = false,
         .decode_offset = 0,
+        .decode_crc = 0,
         .err_count = 0,
     }
 }
@@ -57,7 +66,14 @@ macro_define(COMM_ENC_REGISTER, e_ident, e_downlink, e_replica) {
 
 void comm_enc_reset(comm_enc_t *enc);
 void comm_enc_prepare(comm_enc_t *enc);
-bool comm_enc_encode(comm_enc_t *enc, comm_packet_t *in);
+// encodes the packet only if at least 'headroom' bytes of the downlink buffer would remain free afterwards.
+bool comm_enc_encode_headroom(comm_enc_t *enc, comm_packet_t *in, size_t headroom);
+// returns true if comm_enc_encode_headroom would accept the packet, without encoding it.
+bool comm_enc_fits(comm_enc_t *enc, const comm_packet_t *in, size_t headroom);
+
+static inline bool comm_enc_encode(comm_enc_t *enc, comm_packet_t *in) {
+    return comm_enc_encode_headroom(enc, in, 0);
+}
 void comm_enc_commit(comm_enc_t *enc);
 
 #endif /* FSW_COMM_H */
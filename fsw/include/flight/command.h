@@ -5,6 +5,7 @@
 
 #include <hal/clip.h>
 #include <hal/time.h>
+#include <synch/circular.h>
 #include <synch/duct.h>
 #include <flight/comm.h>
 #include <flight/telemetry.h>
@@ -16,9 +17,18 @@ enum {
     // none of the currently-defined commands exceed this length
     COMMAND_MAX_PARAM_LENGTH = 4,
 
-    // at most one command can be processed per epoch. the worst case is an unrecognized command ID, which will lead to
-    // two telemetry messages.
-    COMMAND_MAX_TELEM_PER_EPOCH = 2,
+    // at most this many commands are decoded from the uplink per epoch. each endpoint still receives at most one
+    // command per epoch; the rest wait in that endpoint's queue, so that a burst aimed at one endpoint cannot hold up
+    // commands aimed at the others.
+    COMMAND_MAX_PER_EPOCH = 4,
+    // number of decoded commands that can wait for each endpoint. a power of two, so that the queue wraps by masking.
+    COMMAND_QUEUE_DEPTH = 4,
+
+    // the worst case for each command is an unrecognized command ID, which will lead to two telemetry messages.
+    COMMAND_MAX_TELEM_PER_EPOCH = 2 * COMMAND_MAX_PER_EPOCH,
+
+    // number of slots in each command system's dispatch table, which is indexed directly by COMMAND_DISPATCH_INDEX.
+    COMMAND_DISPATCH_SLOTS = 16,
 };
 
 typedef enum {
@@ -32,6 +42,16 @@ typedef enum {
     MAG_SET_PWR_STATE_CID = 0x02000001,
 } cmd_id_t;
 
+// command IDs are laid out as (subsystem << 24) | number, so this keeps up to four commands per subsystem apart.
+#define COMMAND_DISPATCH_INDEX(cid) ((((uint32_t) (cid) >> 22) + (uint32_t) (cid)) & (COMMAND_DISPATCH_SLOTS - 1))
+#define COMMAND_DISPATCH_BIT(cid)   (1u << COMMAND_DISPATCH_INDEX(cid))
+// every command ID must have a dispatch slot to itself; the bits only add up to the same value as they OR together
+// if no two of them are the same. new command IDs must be added here.
+static_assert(COMMAND_DISPATCH_SLOTS <= 32, "dispatch bits must fit in a 32-bit word");
+static_assert((COMMAND_DISPATCH_BIT(PING_CID) + COMMAND_DISPATCH_BIT(MAG_SET_PWR_STATE_CID))
+                  == (COMMAND_DISPATCH_BIT(PING_CID) | COMMAND_DISPATCH_BIT(MAG_SET_PWR_STATE_CID)),
+              "command IDs collide in the dispatch table");
+
 typedef const struct {
     cmd_id_t       cid;
     duct_t        *duct;
@@ -52,36 +72,53 @@ typedef const struct {
         } __attribute__((packed)) last_received;
         size_t                    last_data_length;
     } *mut_replicas; // replicated by the number of receiver replicas, NOT the number of command replicas!
+    // commands decoded by the command clip but not yet passed to the endpoint; holds struct cmd_queued entries.
+    circ_buf_t    *queues[COMMAND_REPLICAS];
 } cmd_endpoint_t;
 
+struct cmd_queued {
+    size_t              data_length;
+    struct cmd_duct_msg message;
+};
+
 typedef const struct {
-    cmd_endpoint_t **endpoints;
-    size_t           num_endpoints;
-    tlm_endpoint_t  *telemetry;
+    // indexed by COMMAND_DISPATCH_INDEX of each endpoint's command ID; unused slots are NULL.
+    cmd_endpoint_t *const *dispatch;
+    tlm_endpoint_t        *telemetry;
 } cmd_system_t;
 
 typedef const struct {
     cmd_system_t *system;
     comm_dec_t   *decoder;
     uint8_t       replica_id;
+    struct cmd_replica_mut {
+        // a decoded command whose endpoint queue was full; it is delivered before any further commands are decoded.
+        cmd_endpoint_t   *stalled_endpoint;
+        struct cmd_queued stalled_command;
+    } *mut;
 } cmd_replica_t;
 
 void command_execution_clip(cmd_replica_t *cr);
 
 macro_define(COMMAND_SYSTEM_REGISTER, c_ident, c_uplink_pipe, c_commands) {
-    TELEMETRY_ASYNC_REGISTER(symbol_join(c_ident, telemetry), COMMAND_REPLICAS, COMMAND_MAX_TELEM_PER_EPOCH);
-    cmd_endpoint_t *symbol_join(c_ident, endpoints)[] = c_commands;
+    TELEMETRY_ASYNC_REGISTER(symbol_join(c_ident, telemetry), COMMAND_REPLICAS, COMMAND_MAX_TELEM_PER_EPOCH,
+                             TLM_PRIORITY_CRITICAL);
+    // built from COMMAND_DISPATCH entries; two endpoints in the same slot are rejected by -Woverride-init.
+    cmd_endpoint_t *const symbol_join(c_ident, dispatch)[COMMAND_DISPATCH_SLOTS] = c_commands;
     cmd_system_t c_ident = {
-        .endpoints = symbol_join(c_ident, endpoints),
-        .num_endpoints = sizeof(symbol_join(c_ident, endpoints)) / sizeof(symbol_join(c_ident, endpoints)[0]),
+        .dispatch = symbol_join(c_ident, dispatch),
         .telemetry = &symbol_join(c_ident, telemetry),
     };
     static_repeat(COMMAND_REPLICAS, c_replica_id) {
         COMM_DEC_REGISTER(symbol_join(c_ident, decoder, c_replica_id), c_uplink_pipe, c_replica_id);
+        struct cmd_replica_mut symbol_join(c_ident, replica_mut, c_replica_id) = {
+            .stalled_endpoint = NULL,
+        };
         cmd_replica_t symbol_join(c_ident, replica, c_replica_id) = {
             .system = &c_ident,
             .decoder = &symbol_join(c_ident, decoder, c_replica_id),
             .replica_id = c_replica_id,
+            .mut = &symbol_join(c_ident, replica_mut, c_replica_id),
         };
         CLIP_REGISTER(symbol_join(c_ident, clip, c_replica_id),
                       command_execution_clip, &symbol_join(c_ident, replica, c_replica_id));
@@ -96,13 +133,27 @@ macro_define(COMMAND_ENDPOINT, e_ident, e_command_id, e_receiver_replicas) {
             .has_outstanding_reply = false,
         },
     };
+    static_repeat(COMMAND_REPLICAS, e_replica_id) {
+        CIRC_BUF_REGISTER(symbol_join(e_ident, queue, e_replica_id), sizeof(struct cmd_queued), COMMAND_QUEUE_DEPTH);
+    }
     cmd_endpoint_t e_ident = {
         .cid = (e_command_id),
         .duct = &symbol_join(e_ident, duct),
         .mut_replicas = symbol_join(e_ident, mutable_replicas),
+        .queues = {
+            static_repeat(COMMAND_REPLICAS, e_replica_id) {
+                &symbol_join(e_ident, queue, e_replica_id),
+            }
+        },
     }
 }
 
+// an entry in the command list passed to COMMAND_SYSTEM_REGISTER. e_command_id must match the ID the endpoint was
+// registered with.
+macro_define(COMMAND_DISPATCH, e_ident, e_command_id) {
+    [COMMAND_DISPATCH_INDEX(e_command_id)] = &e_ident,
+}
+
 macro_define(COMMAND_SCHEDULE, c_ident) {
     static_repeat(COMMAND_REPLICAS, c_replica_id) {
         CLIP_SCHEDULE(symbol_join(c_ident, clip, c_replica_id), 100)
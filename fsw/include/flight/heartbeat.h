@@ -22,7 +22,7 @@ typedef const struct {
 void heartbeat_main_clip(heartbeat_replica_t *h);
 
 macro_define(HEARTBEAT_REGISTER, h_ident) {
-    TELEMETRY_ASYNC_REGISTER(symbol_join(h_ident, telemetry), HEARTBEAT_REPLICAS, 1);
+    TELEMETRY_ASYNC_REGISTER(symbol_join(h_ident, telemetry), HEARTBEAT_REPLICAS, 1, TLM_PRIORITY_CRITICAL);
     WATCHDOG_ASPECT(symbol_join(h_ident, aspect), 1 * CLOCK_NS_PER_SEC, HEARTBEAT_REPLICAS);
     NOTEPAD_REGISTER(symbol_join(h_ident, notepad), HEARTBEAT_REPLICAS, sizeof(struct heartbeat_note));
     static_repeat(HEARTBEAT_REPLICAS, h_replica_id) {
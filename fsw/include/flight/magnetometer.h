@@ -14,8 +14,15 @@
 // use default number of replicas
 #define MAGNETOMETER_REPLICAS CONFIG_APPLICATION_REPLICAS
 
+// MAGNETOMETER_DELTA_ENCODING can be set to one of two values:
+//   [0] Readings will be downlinked as fixed-size records.
+//   [1] Readings will be downlinked as deltas from the previous reading, unless that would take more space.
+#define MAGNETOMETER_DELTA_ENCODING 1
+
 enum {
-    MAGNETOMETER_MAX_READINGS = 100,
+    MAGNETOMETER_MAX_READINGS = 128, // power of two, so that the circular buffer can wrap by masking
+    // a full buffer can be downlinked in one readings map, which still fits in the downlink encoder.
+    MAGNETOMETER_MAX_READINGS_PER_MAP = MAGNETOMETER_MAX_READINGS,
 };
 
 enum magnetometer_state {
@@ -65,8 +72,9 @@ typedef const struct {
 void magnetometer_clip(magnetometer_replica_t *mag);
 
 macro_define(MAGNETOMETER_REGISTER, m_ident, m_address, m_switch_in, m_switch_out, m_switch_port) {
-    TELEMETRY_ASYNC_REGISTER(symbol_join(m_ident, telemetry_async), MAGNETOMETER_REPLICAS, 2);
-    TELEMETRY_SYNC_REGISTER(symbol_join(m_ident, telemetry_sync), MAGNETOMETER_REPLICAS, 1);
+    TELEMETRY_ASYNC_REGISTER(symbol_join(m_ident, telemetry_async), MAGNETOMETER_REPLICAS, 2, TLM_PRIORITY_NORMAL);
+    TELEMETRY_SYNC_REGISTER(symbol_join(m_ident, telemetry_sync), MAGNETOMETER_REPLICAS, 1,
+                            TLM_MAG_READINGS_MAP_SIZE(MAGNETOMETER_MAX_READINGS_PER_MAP), TLM_PRIORITY_BULK);
     COMMAND_ENDPOINT(symbol_join(m_ident, command), MAG_SET_PWR_STATE_CID, MAGNETOMETER_REPLICAS);
     RMAP_ON_SWITCHES(symbol_join(m_ident, endpoint), MAGNETOMETER_REPLICAS, m_switch_in, m_switch_out,
                      m_switch_port, m_address, 8, 4);
@@ -106,7 +114,7 @@ macro_define(MAGNETOMETER_TELEMETRY, m_ident) {
 }
 
 macro_define(MAGNETOMETER_COMMAND, m_ident) {
-    &symbol_join(m_ident, command),
+    COMMAND_DISPATCH(symbol_join(m_ident, command), MAG_SET_PWR_STATE_CID)
 }
 
 #endif /* FSW_MAGNETOMETER_H */
@@ -17,7 +17,7 @@ typedef const struct {
 void pingback_clip(pingback_replica_t *p);
 
 macro_define(PINGBACK_REGISTER, p_ident) {
-    TELEMETRY_ASYNC_REGISTER(symbol_join(p_ident, telemetry), PINGBACK_REPLICAS, 2);
+    TELEMETRY_ASYNC_REGISTER(symbol_join(p_ident, telemetry), PINGBACK_REPLICAS, 2, TLM_PRIORITY_NORMAL);
     COMMAND_ENDPOINT(symbol_join(p_ident, command), PING_CID, PINGBACK_REPLICAS);
     static_repeat(PINGBACK_REPLICAS, p_replica_id) {
         pingback_replica_t symbol_join(p_ident, replica, p_replica_id) = {
@@ -41,7 +41,7 @@ macro_define(PINGBACK_TELEMETRY, p_ident) {
 }
 
 macro_define(PINGBACK_COMMAND, p_ident) {
-    &symbol_join(p_ident, command),
+    COMMAND_DISPATCH(symbol_join(p_ident, command), PING_CID)
 }
 
 #endif /* FSW_FLIGHT_PINGBACK_H */
@@ -0,0 +1,42 @@
+#ifndef FSW_FLIGHT_PROFILER_H
+#define FSW_FLIGHT_PROFILER_H
+
+#include <hal/clip.h>
+#include <hal/profile.h>
+#include <flight/telemetry.h>
+
+// the profile describes the platform's own scheduling, rather than replicated state, so it is only reported once.
+#define PROFILER_REPLICAS 1
+
+typedef const struct {
+    struct profiler_mut {
+        uint32_t     next_partition;
+        local_time_t last_report_time;
+    } *mut;
+    tlm_endpoint_t *telemetry;
+} profiler_t;
+
+void profiler_clip(profiler_t *p);
+
+macro_define(PROFILER_REGISTER, p_ident) {
+    TELEMETRY_ASYNC_REGISTER(symbol_join(p_ident, telemetry), PROFILER_REPLICAS, 1, TLM_PRIORITY_BULK);
+    struct profiler_mut symbol_join(p_ident, mutable) = {
+        .next_partition = 0,
+        .last_report_time = 0,
+    };
+    profiler_t p_ident = {
+        .mut = &symbol_join(p_ident, mutable),
+        .telemetry = &symbol_join(p_ident, telemetry),
+    };
+    CLIP_REGISTER(symbol_join(p_ident, clip), profiler_clip, &p_ident)
+}
+
+macro_define(PROFILER_SCHEDULE, p_ident) {
+    CLIP_SCHEDULE(symbol_join(p_ident, clip), 10)
+}
+
+macro_define(PROFILER_TELEMETRY, p_ident) {
+    TELEMETRY_ENDPOINT_REF(symbol_join(p_ident, telemetry))
+}
+
+#endif /* FSW_FLIGHT_PROFILER_H */
@@ -6,6 +6,7 @@
 
 #include <hal/clip.h>
 #include <hal/init.h>
+#include <hal/profile.h>
 #include <hal/watchdog.h>
 #include <synch/circular.h>
 #include <synch/duct.h>
@@ -15,31 +16,54 @@
 // use default number of replicas
 #define TELEMETRY_REPLICAS CONFIG_APPLICATION_REPLICAS
 
+// telemetry is downlinked in priority order each epoch. lower-priority classes must leave some of the downlink buffer
+// free, so that they cannot starve higher-priority classes when the radio falls behind.
+typedef enum {
+    TLM_PRIORITY_CRITICAL = 0, // heartbeats and command acknowledgements
+    TLM_PRIORITY_NORMAL,       // routine status reports
+    TLM_PRIORITY_BULK,         // large data products, which can wait for spare bandwidth
+    TLM_PRIORITY_COUNT,
+} tlm_priority_t;
+
 enum {
+    // bytes of downlink buffer that each class must leave free for the classes above it
+    TLM_HEADROOM_NORMAL = 128,
+    TLM_HEADROOM_BULK   = 256,
+
     TLM_MAX_ASYNC_SIZE = 16,
-    TLM_MAX_SYNC_SIZE  = 64 * 1024,
-    TLM_MAX_MAG_READINGS_PER_MAP = (TLM_MAX_SYNC_SIZE - 2 * sizeof(uint64_t)) / 14,
+    // each endpoint declares its own maximum, but no synchronous record may exceed what the encoder can downlink,
+    // even while leaving headroom for higher-priority telemetry.
+    TLM_MAX_SYNC_SIZE  = (COMM_SCRATCH_SIZE - TLM_HEADROOM_BULK - COMM_ENC_FRAMING_LENGTH) / 2,
+    TLM_MAG_READING_SIZE = 14,
 };
 
+// encoded size of a magnetometer readings map containing the specified number of readings
+#define TLM_MAG_READINGS_MAP_SIZE(n) (2 * sizeof(uint64_t) + TLM_MAG_READING_SIZE * (n))
+
 // should fit on the stack
 typedef struct {
     uint32_t telemetry_id;
     uint8_t  data_bytes[TLM_MAX_ASYNC_SIZE];
 } tlm_async_t;
 
-// probably doesn't fit on the stack
+// storage is sized per endpoint, based on the maximum size passed to TELEMETRY_SYNC_REGISTER.
 typedef struct {
     uint32_t telemetry_id;
-    uint8_t  data_bytes[TLM_MAX_SYNC_SIZE];
+    uint8_t  data_bytes[];
 } tlm_sync_t;
 
-// slot for a tlm_sync_t and a length field.
+// slot for a tlm_sync_t and a length field. the tlm_sync_t is stored in sync_data.
 typedef struct {
     size_t       data_length;
     local_time_t timestamp;
-    tlm_sync_t   sync_data;
+    uint8_t      sync_data[];
 } tlm_sync_slot_t;
 
+// size of a receiver scratch slot for records of up to the specified size, rounded up to keep slots aligned.
+#define TLM_SYNC_SLOT_SIZE(max_size) \
+    ((sizeof(tlm_sync_slot_t) + sizeof(tlm_sync_t) + (max_size) + __alignof__(tlm_sync_slot_t) - 1) \
+        / __alignof__(tlm_sync_slot_t) * __alignof__(tlm_sync_slot_t))
+
 typedef struct {
     mission_time_t reading_time;
     int16_t        mag_x;
@@ -53,7 +77,10 @@ typedef const struct {
         duct_t *async_duct;
         struct {
             pipe_t     *sync_pipe;
-            tlm_sync_t *sender_scratch;
+            size_t      sync_max_size;
+            // one tlm_sync_t with room for sync_max_size data bytes per sender replica, sender_stride bytes apart.
+            uint8_t    *sender_scratch;
+            size_t      sender_stride;
         };
     };
 } tlm_endpoint_t;
@@ -70,6 +97,7 @@ typedef const struct {
 } tlm_registration_replica_t;
 
 typedef const struct {
+    tlm_priority_t             priority;
     tlm_registration_replica_t replicas[TELEMETRY_REPLICAS];
 } tlm_registration_t;
 
@@ -84,7 +112,7 @@ typedef struct {
 
 typedef const struct {
     struct tlm_system_mut {
-        uint32_t async_dropped;
+        uint32_t async_dropped[TLM_PRIORITY_COUNT];
     } *mut;
     uint8_t                     replica_id;
     comm_enc_t                 *comm_encoder;
@@ -101,7 +129,7 @@ macro_define(TELEMETRY_SYSTEM_REGISTER, t_ident, t_pipe, t_components) {
         COMM_ENC_REGISTER(symbol_join(t_ident, encoder, t_replica_id), t_pipe, t_replica_id);
         tlm_registration_t * const symbol_join(t_ident, registrations, t_replica_id)[] = t_components;
         struct tlm_system_mut symbol_join(t_ident, mutable, t_replica_id) = {
-            .async_dropped = 0,
+            .async_dropped = { 0 },
         };
         tlm_replica_t symbol_join(t_ident, replica, t_replica_id) = {
             .mut = &symbol_join(t_ident, mutable, t_replica_id),
@@ -126,7 +154,7 @@ macro_define(TELEMETRY_WATCH, t_ident) {
     &symbol_join(t_ident, aspect),
 }
 
-macro_define(TELEMETRY_ASYNC_REGISTER, e_ident, e_replicas, e_max_flow) {
+macro_define(TELEMETRY_ASYNC_REGISTER, e_ident, e_replicas, e_max_flow, e_priority) {
     DUCT_REGISTER(symbol_join(e_ident, duct), e_replicas, TELEMETRY_REPLICAS, e_max_flow, sizeof(tlm_async_t),
                   DUCT_SENDER_FIRST);
     tlm_endpoint_t e_ident = {
@@ -134,6 +162,7 @@ macro_define(TELEMETRY_ASYNC_REGISTER, e_ident, e_replicas, e_max_flow) {
         .async_duct = &symbol_join(e_ident, duct),
     };
     tlm_registration_t symbol_join(e_ident, reg) = {
+        .priority = (e_priority),
         .replicas = {
             [0 ... TELEMETRY_REPLICAS-1] = {
                 .is_synchronous = false,
@@ -143,19 +172,29 @@ macro_define(TELEMETRY_ASYNC_REGISTER, e_ident, e_replicas, e_max_flow) {
     }
 }
 
-macro_define(TELEMETRY_SYNC_REGISTER, e_ident, e_replicas, e_max_flow) {
-    PIPE_REGISTER(symbol_join(e_ident, pipe), e_replicas, TELEMETRY_REPLICAS, e_max_flow, sizeof(tlm_sync_t),
-                  PIPE_SENDER_FIRST);
-    tlm_sync_t symbol_join(e_ident, sender_scratch)[e_replicas];
+// e_max_size is the largest number of data bytes that the endpoint will ever submit in a single record.
+macro_define(TELEMETRY_SYNC_REGISTER, e_ident, e_replicas, e_max_flow, e_max_size, e_priority) {
+    static_assert((e_max_size) > 0 && (e_max_size) <= TLM_MAX_SYNC_SIZE,
+                  "synchronous telemetry record must fit in the downlink encoder");
+    PIPE_REGISTER(symbol_join(e_ident, pipe), e_replicas, TELEMETRY_REPLICAS, e_max_flow,
+                  sizeof(tlm_sync_t) + (e_max_size), PIPE_SENDER_FIRST);
+    struct {
+        uint32_t telemetry_id;
+        uint8_t  data_bytes[e_max_size];
+    } symbol_join(e_ident, sender_scratch)[e_replicas];
     tlm_endpoint_t e_ident = {
         .is_synchronous = true,
         .sync_pipe = &symbol_join(e_ident, pipe),
-        .sender_scratch = symbol_join(e_ident, sender_scratch),
+        .sync_max_size = (e_max_size),
+        .sender_scratch = (uint8_t *) symbol_join(e_ident, sender_scratch),
+        .sender_stride = sizeof(symbol_join(e_ident, sender_scratch)[0]),
     };
     static_repeat(TELEMETRY_REPLICAS, replica_id) {
-        CIRC_BUF_REGISTER(symbol_join(e_ident, receiver_scratch, replica_id), sizeof(tlm_sync_slot_t), e_max_flow);
+        CIRC_BUF_REGISTER(symbol_join(e_ident, receiver_scratch, replica_id),
+                          TLM_SYNC_SLOT_SIZE(e_max_size), e_max_flow);
     }
     tlm_registration_t symbol_join(e_ident, reg) = {
+        .priority = (e_priority),
         .replicas = {
             static_repeat(TELEMETRY_REPLICAS, replica_id) {
                 {
@@ -184,8 +223,12 @@ void tlm_cmd_not_recognized(tlm_txn_t *txn, uint64_t original_timestamp, uint32_
 void tlm_pong(tlm_txn_t *txn, uint32_t ping_id);
 void tlm_clock_calibrated(tlm_txn_t *txn, int64_t adjustment);
 void tlm_heartbeat(tlm_txn_t *txn);
+void tlm_clip_profile(tlm_txn_t *txn, uint32_t partition, const profile_summary_t *summary);
 void tlm_mag_pwr_state_changed(tlm_txn_t *txn, bool power_state);
-void tlm_mag_readings_map(tlm_txn_t *txn, uint64_t earliest_time, uint64_t latest_time, size_t fetch_count,
-                          void (*fetch)(void *param, size_t index, tlm_mag_reading_t *out), void *param);
+// the readings are passed as spans of tlm_mag_reading_t, as provided by circ_buf_read_peek_spans. if delta_encode is
+// set, readings are sent as varint deltas from the previous reading whenever that is no larger than sending them as
+// fixed-size records.
+void tlm_mag_readings_map(tlm_txn_t *txn, uint64_t earliest_time, uint64_t latest_time,
+                          const circ_span_t *spans, size_t num_spans, bool delta_encode);
 
 #endif /* FSW_TLM_H */
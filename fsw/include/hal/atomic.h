@@ -9,6 +9,8 @@
 #define atomic_fetch_and(x, v) (__atomic_fetch_and(&(x), (v), __ATOMIC_ACQ_REL))
 #define atomic_fetch_sub(x, v) (__atomic_fetch_sub(&(x), (v), __ATOMIC_ACQ_REL))
 #define atomic_exchange(x, v) (__atomic_exchange_n(&(x), (v), __ATOMIC_ACQ_REL))
+// orders earlier stores before later loads, for handshakes where each side stores a flag and then checks the other's
+#define atomic_fence() (__atomic_thread_fence(__ATOMIC_SEQ_CST))
 
 #define atomic_load_relaxed(x) (__atomic_load_n(&(x), __ATOMIC_RELAXED))
 #define atomic_store_relaxed(x, v) (__atomic_store_n(&(x), (v), __ATOMIC_RELAXED))
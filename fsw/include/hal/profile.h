@@ -0,0 +1,82 @@
+#ifndef FSW_HAL_PROFILE_H
+#define FSW_HAL_PROFILE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <hal/time.h>
+
+enum {
+    // the histogram divides each partition's budget into eighths, and keeps counting up to twice the budget.
+    PROFILE_BUCKETS_PER_BUDGET = 8,
+    PROFILE_BUCKETS            = 2 * PROFILE_BUCKETS_PER_BUDGET + 1, // the last bucket collects everything beyond
+};
+
+// execution times of the clip scheduled in a single schedule partition
+typedef struct {
+    uint32_t runs;
+    uint32_t overruns;
+    uint64_t total_ns;
+    uint32_t min_ns;
+    uint32_t max_ns;
+    uint32_t histogram[PROFILE_BUCKETS];
+} profile_t;
+
+typedef struct {
+    uint32_t runs;
+    uint32_t overruns;
+    uint32_t min_ns;
+    uint32_t mean_ns;
+    uint32_t p99_ns; // upper edge of the histogram bucket containing the 99th percentile, or max_ns if lower
+    uint32_t max_ns;
+} profile_summary_t;
+
+// records a single run of a partition. a run that was cut off by the end of its partition should be recorded as
+// taking exactly its budget.
+static inline void profile_record(profile_t *p, uint32_t budget_ns, uint64_t elapsed_ns, bool overran) {
+    uint32_t elapsed = elapsed_ns > UINT32_MAX ? UINT32_MAX : (uint32_t) elapsed_ns;
+    if (p->runs == 0 || elapsed < p->min_ns) {
+        p->min_ns = elapsed;
+    }
+    if (elapsed > p->max_ns) {
+        p->max_ns = elapsed;
+    }
+    p->runs++;
+    p->total_ns += elapsed;
+    if (overran || elapsed > budget_ns) {
+        p->overruns++;
+    }
+    uint64_t bucket = budget_ns == 0 ? PROFILE_BUCKETS - 1
+                                     : (uint64_t) elapsed * PROFILE_BUCKETS_PER_BUDGET / budget_ns;
+    p->histogram[bucket < PROFILE_BUCKETS ? bucket : PROFILE_BUCKETS - 1]++;
+}
+
+static inline void profile_summarize(const profile_t *p, uint32_t budget_ns, profile_summary_t *out) {
+    *out = (profile_summary_t) {
+        .runs     = p->runs,
+        .overruns = p->overruns,
+        .min_ns   = p->min_ns,
+        .mean_ns  = p->runs ? (uint32_t) (p->total_ns / p->runs) : 0,
+        .p99_ns   = p->max_ns,
+        .max_ns   = p->max_ns,
+    };
+    // find the first bucket by which at least 99% of runs have completed
+    uint64_t threshold = ((uint64_t) p->runs * 99 + 99) / 100, seen = 0;
+    for (uint32_t bucket = 0; bucket < PROFILE_BUCKETS - 1; bucket++) {
+        seen += p->histogram[bucket];
+        if (seen >= threshold && seen > 0) {
+            uint64_t edge = (uint64_t) budget_ns * (bucket + 1) / PROFILE_BUCKETS_PER_BUDGET;
+            if (edge < out->p99_ns) {
+                out->p99_ns = (uint32_t) edge;
+            }
+            break;
+        }
+    }
+}
+
+// implemented by each platform: the number of schedule partitions, and the profile of one of them. returns false if
+// the partition does not exist.
+uint32_t clip_profile_partitions(void);
+bool clip_profile_summary(uint32_t partition, profile_summary_t *out, const char **label_out);
+
+#endif /* FSW_HAL_PROFILE_H */
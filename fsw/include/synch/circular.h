@@ -5,6 +5,7 @@
  * This file contains an implementation of a single-threaded circular buffer data structure.
  */
 
+#include <stdbool.h>
 #include <stdint.h>
 
 #include <hal/debug.h>
@@ -14,14 +15,22 @@ typedef uint32_t circ_index_t;
 typedef const struct {
     size_t       element_size;
     circ_index_t element_count;
+    // if element_count is a power of two, indices run freely and are wrapped by masking with element_count - 1.
+    // otherwise, indices wrap at 2 * element_count and are reduced with a division.
+    bool         power_of_two;
     uint8_t     *element_storage;
     struct circ_buf_mut {
-        // these both wrap at 2 * element_count
         circ_index_t next_read;
         circ_index_t next_write;
     } *mut;
 } circ_buf_t;
 
+// a run of contiguous elements in a circular buffer's storage
+typedef struct {
+    void        *elements;
+    circ_index_t count;
+} circ_span_t;
+
 macro_define(CIRC_BUF_REGISTER, c_ident, c_element_size, c_element_count) {
     static_assert(c_element_size > 0 && c_element_size == (size_t) c_element_size, "positive note size");
     static_assert(c_element_count > 0 && c_element_count == (circ_index_t) c_element_count, "positive note count");
@@ -33,6 +42,7 @@ macro_define(CIRC_BUF_REGISTER, c_ident, c_element_size, c_element_count) {
     circ_buf_t c_ident = {
         .element_size = (c_element_size),
         .element_count = (c_element_count),
+        .power_of_two = ((c_element_count) & ((c_element_count) - 1)) == 0,
         .element_storage = symbol_join(c_ident, storage),
         .mut = &symbol_join(c_ident, mutable),
     }
@@ -53,6 +63,24 @@ static inline void *circ_buf_get_element(circ_buf_t *c, circ_index_t index) {
     return &c->element_storage[c->element_size * index];
 }
 
+// converts a read or write position into an index into the element storage
+static inline circ_index_t circ_buf_wrap(circ_buf_t *c, circ_index_t position) {
+    if (c->power_of_two) {
+        return position & (c->element_count - 1);
+    } else {
+        return position % c->element_count;
+    }
+}
+
+// advances a read or write position
+static inline circ_index_t circ_buf_advance(circ_buf_t *c, circ_index_t position, circ_index_t count) {
+    if (c->power_of_two) {
+        return position + count;
+    } else {
+        return (position + count) % (2 * c->element_count);
+    }
+}
+
 // function to call on clip/task restart, to ensure that the circular buffer is in a safe state.
 static inline void circ_buf_reset(circ_buf_t *c) {
     assert(c != NULL && c->mut != NULL);
@@ -64,7 +92,12 @@ static inline void circ_buf_reset(circ_buf_t *c) {
 static inline circ_index_t circ_buf_read_avail(circ_buf_t *c) {
     assert(c != NULL && c->mut != NULL);
     // write leads, read lags
-    circ_index_t ahead = (c->mut->next_write - c->mut->next_read + 2 * c->element_count) % (2 * c->element_count);
+    circ_index_t ahead;
+    if (c->power_of_two) {
+        ahead = c->mut->next_write - c->mut->next_read;
+    } else {
+        ahead = (c->mut->next_write - c->mut->next_read + 2 * c->element_count) % (2 * c->element_count);
+    }
     assertf(ahead <= c->element_count, "ahead=%u, element_count=%u", ahead, c->element_count);
     return ahead;
 }
@@ -73,17 +106,42 @@ static inline circ_index_t circ_buf_read_avail(circ_buf_t *c) {
 static inline void *circ_buf_read_peek(circ_buf_t *c, circ_index_t index) {
     assert(c != NULL && c->mut != NULL);
     if (index < circ_buf_read_avail(c)) {
-        return circ_buf_get_element(c, (c->mut->next_read + index) % c->element_count);
+        return circ_buf_get_element(c, circ_buf_wrap(c, c->mut->next_read + index));
     } else {
         return NULL;
     }
 }
 
+// fills in up to two spans covering the first 'count' elements starting at 'position', and returns how many were used.
+static inline size_t circ_buf_spans(circ_buf_t *c, circ_index_t position, circ_index_t count, circ_span_t spans[2]) {
+    assert(c != NULL && spans != NULL && count <= c->element_count);
+    if (count == 0) {
+        return 0;
+    }
+    circ_index_t start = circ_buf_wrap(c, position);
+    circ_index_t first = c->element_count - start;
+    if (first >= count) {
+        spans[0] = (circ_span_t) { .elements = circ_buf_get_element(c, start), .count = count };
+        return 1;
+    }
+    spans[0] = (circ_span_t) { .elements = circ_buf_get_element(c, start), .count = first };
+    spans[1] = (circ_span_t) { .elements = circ_buf_get_element(c, 0), .count = count - first };
+    return 2;
+}
+
+// like circ_buf_read_peek, but provides up to max_count of the next readable elements at once, as up to two spans.
+// returns the number of spans filled in.
+static inline size_t circ_buf_read_peek_spans(circ_buf_t *c, circ_index_t max_count, circ_span_t spans[2]) {
+    assert(c != NULL && c->mut != NULL);
+    circ_index_t avail = circ_buf_read_avail(c);
+    return circ_buf_spans(c, c->mut->next_read, max_count < avail ? max_count : avail, spans);
+}
+
 // once the data seen in peek has been consumed, call this to advance the read pointer.
 static inline void circ_buf_read_done(circ_buf_t *c, circ_index_t count) {
     assert(c != NULL);
     assert(1 <= count && count <= circ_buf_read_avail(c));
-    c->mut->next_read += count;
+    c->mut->next_read = circ_buf_advance(c, c->mut->next_read, count);
 }
 
 // return the number of elements available to be written
@@ -96,17 +154,25 @@ static inline circ_index_t circ_buf_write_avail(circ_buf_t *c) {
 static inline void *circ_buf_write_peek(circ_buf_t *c, circ_index_t index) {
     assert(c != NULL && c->mut != NULL);
     if (index < circ_buf_write_avail(c)) {
-        return circ_buf_get_element(c, (c->mut->next_write + index) % c->element_count);
+        return circ_buf_get_element(c, circ_buf_wrap(c, c->mut->next_write + index));
     } else {
         return NULL;
     }
 }
 
+// like circ_buf_write_peek, but provides up to max_count of the next writable elements at once, as up to two spans.
+// returns the number of spans filled in.
+static inline size_t circ_buf_write_peek_spans(circ_buf_t *c, circ_index_t max_count, circ_span_t spans[2]) {
+    assert(c != NULL && c->mut != NULL);
+    circ_index_t avail = circ_buf_write_avail(c);
+    return circ_buf_spans(c, c->mut->next_write, max_count < avail ? max_count : avail, spans);
+}
+
 // once data has been written to the buffer provided by peek, call this to advance the read pointer.
 static inline void circ_buf_write_done(circ_buf_t *c, circ_index_t count) {
     assert(c != NULL);
     assert(1 <= count && count <= circ_buf_write_avail(c));
-    c->mut->next_write += count;
+    c->mut->next_write = circ_buf_advance(c, c->mut->next_write, count);
 }
 
 #endif /* FSW_SYNCH_CIRCULAR_H */
@@ -11,6 +11,11 @@
 //   [1] Voting notepads will automatically resynchronize each scheduling cycle.
 #define CONFIG_SYNCH_NOTEPADS_ENABLED 1
 
+// CONFIG_SYNCH_DUCT_DIGESTS can be set to one of two values:
+//   [0] Duct messages will be voted by comparing their full contents.
+//   [1] Duct messages will be voted by comparing digests computed at send time, and checked against them on receipt.
+#define CONFIG_SYNCH_DUCT_DIGESTS 1
+
 // CONFIG_APPLICATION_REPLICAS can be set to the number of replicas for ordinary application components to use.
 #define CONFIG_APPLICATION_REPLICAS 3
 
@@ -15,9 +15,11 @@
  */
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #include <hal/debug.h>
+#include <synch/config.h>
 #include <synch/flag.h>
 
 enum {
@@ -60,8 +62,17 @@ typedef struct {
     size_t       size;
     /* TODO: consider eliminating this, and requiring users incorporate timestamp information in the body itself */
     local_time_t timestamp;
+#if ( CONFIG_SYNCH_DUCT_DIGESTS == 1 )
+    uint32_t     digest;
+    uint32_t     digest_padding; // keeps the body 8-byte aligned
+#endif
     uint8_t      body[];
 } duct_message_t;
+static_assert(offsetof(duct_message_t, body) % 8 == 0, "duct message bodies must be 8-byte aligned");
+
+// each flow slot is padded so that every message header (and therefore every borrowed message body) stays aligned.
+#define DUCT_SLOT_SIZE(message_size) \
+    ((sizeof(duct_message_t) + (message_size) + _Alignof(duct_message_t) - 1) & ~(_Alignof(duct_message_t) - 1))
 
 enum duct_polarity {
     DUCT_SENDER_FIRST,
@@ -78,8 +89,8 @@ macro_define(DUCT_REGISTER,
                   "invalid max flow setting for duct");
     static_assert(d_message_size >= 1, "invalid message size setting");
     uint8_t symbol_join(d_ident, buf)[
-        (d_sender_replicas) * (d_max_flow) * (sizeof(duct_message_t) + (d_message_size))
-    ];
+        (d_sender_replicas) * (d_max_flow) * DUCT_SLOT_SIZE(d_message_size)
+    ] __attribute__((aligned(_Alignof(duct_message_t))));
     duct_flow_index symbol_join(d_ident, flow_statuses)[(d_sender_replicas) * (d_receiver_replicas)] = {
         [0 ... ((d_sender_replicas) * (d_receiver_replicas) - 1)] =
                 ((d_polarity) == DUCT_SENDER_FIRST) ? DUCT_MISSING_FLOW : 0,
@@ -114,7 +125,7 @@ static inline duct_message_t *duct_lookup_message(duct_t *duct, uint8_t sender_i
     assert(sender_id < duct->sender_replicas);
     assert(flow_index < duct->max_flow);
     return (duct_message_t *) &duct->message_buffer[
-        ((sender_id * duct->max_flow) + flow_index) * (sizeof(duct_message_t) + duct->message_size)
+        ((sender_id * duct->max_flow) + flow_index) * DUCT_SLOT_SIZE(duct->message_size)
     ];
 }
 
@@ -128,11 +139,17 @@ void duct_send_prepare(duct_txn_t *txn, duct_t *duct, uint8_t sender_id);
 bool duct_send_allowed(duct_txn_t *txn);
 // asserts if we've used up our max flow in this transaction already
 void duct_send_message(duct_txn_t *txn, const void *message_in, size_t size, local_time_t timestamp);
+// like duct_send_message, but gathers the message from two separate spans (such as the two halves of a ring buffer)
+void duct_send_message_split(duct_txn_t *txn, const void *first, size_t first_size,
+                             const void *second, size_t second_size, local_time_t timestamp);
 void duct_send_commit(duct_txn_t *txn);
 
 void duct_receive_prepare(duct_txn_t *txn, duct_t *duct, uint8_t receiver_id);
 // returns size > 0 if a message was successfully received. if size = 0, then we're done with this transaction.
 size_t duct_receive_message(duct_txn_t *txn, void *message_out, local_time_t *timestamp_out);
+// like duct_receive_message, but instead of copying the message out, provides a pointer to the voted message within
+// the duct's own flow slot. the pointer remains valid only until duct_receive_commit is called on this transaction.
+size_t duct_receive_borrow(duct_txn_t *txn, const uint8_t **message_out, local_time_t *timestamp_out);
 // asserts if we left any messages unprocessed
 void duct_receive_commit(duct_txn_t *txn);
 
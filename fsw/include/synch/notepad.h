@@ -17,8 +17,17 @@
 
 enum {
     NOTEPAD_UNINITIALIZED = 0xFF,
+
+    // granularity at which dirty regions are tracked for incremental voting
+    NOTEPAD_BLOCK_SIZE = 16,
+    // even when only some blocks are dirty, every Nth feedforward per replica compares the entire state
+    NOTEPAD_FULL_VOTE_INTERVAL = 16,
 };
 
+// number of 32-bit words required for a dirty bitmap covering a notepad of the specified size
+#define NOTEPAD_DIRTY_WORDS(state_size) \
+    (((state_size) + NOTEPAD_BLOCK_SIZE * 32 - 1) / (NOTEPAD_BLOCK_SIZE * 32))
+
 #if ( CONFIG_SYNCH_NOTEPADS_ENABLED == 1 )
 
 typedef const struct {
@@ -27,13 +36,19 @@ typedef const struct {
     uint8_t  num_replicas;
     uint8_t  replica_id;
     uint8_t *flip_states; // each flip state is 0 or 1
-    uint8_t *mutable_state;
-    size_t   state_size;
+    uint8_t  *mutable_state;
+    size_t    state_size;
+    // one dirty bitmap per region, in the same layout as mutable_state
+    uint32_t *dirty_maps;
+    size_t    dirty_words;
+    uint8_t  *vote_counters;
 } notepad_ref_t;
 
 macro_define(NOTEPAD_REGISTER, n_ident, n_replicas, n_state_size) {
     uint8_t symbol_join(n_ident, flip_states)[n_replicas] = { [0 ... n_replicas - 1] = NOTEPAD_UNINITIALIZED };
     uint8_t symbol_join(n_ident, mutable_state)[(n_replicas) * 2 * (n_state_size)];
+    uint32_t symbol_join(n_ident, dirty_maps)[(n_replicas) * 2 * NOTEPAD_DIRTY_WORDS(n_state_size)];
+    uint8_t symbol_join(n_ident, vote_counters)[n_replicas];
     static_repeat(n_replicas, n_replica_id) {
         notepad_ref_t symbol_join(n_ident, replica, n_replica_id) = {
             .label = symbol_str(n_ident),
@@ -42,6 +57,9 @@ macro_define(NOTEPAD_REGISTER, n_ident, n_replicas, n_state_size) {
             .flip_states = symbol_join(n_ident, flip_states),
             .mutable_state = symbol_join(n_ident, mutable_state),
             .state_size = (n_state_size),
+            .dirty_maps = symbol_join(n_ident, dirty_maps),
+            .dirty_words = NOTEPAD_DIRTY_WORDS(n_state_size),
+            .vote_counters = symbol_join(n_ident, vote_counters),
         };
     }
 }
@@ -72,4 +90,15 @@ macro_define(NOTEPAD_REPLICA_REF, n_ident, n_replica_id) {
 // if no valid data can be voted on, will clear the current state. *valid_out will be set to false.
 void *notepad_feedforward(notepad_ref_t *replica, bool *valid_out);
 
+// like notepad_feedforward, but the caller promises to report every modification to the returned state through
+// notepad_mark_dirty. blocks not marked dirty by any replica are only compared during periodic full votes.
+void *notepad_feedforward_tracked(notepad_ref_t *replica, bool *valid_out);
+
+// records that [field, field + length) in the state returned by notepad_feedforward_tracked has been modified.
+void notepad_mark_dirty(notepad_ref_t *replica, const void *field, size_t length);
+
+// records every block of the state returned by notepad_feedforward_tracked that differs from baseline, which must be a
+// copy of that state taken before any modifications. for writers whose changes are too scattered to mark individually.
+void notepad_mark_changes(notepad_ref_t *replica, const void *baseline);
+
 #endif /* FSW_SYNCH_NOTEPAD_H */
@@ -9,6 +9,9 @@
  * The capacity of these buffers must be at least the message size of the underlying pipes. However, it is recommended
  * that the buffers are sized at twice the message size of the underlying pipes to avoid edge cases that slow down
  * transfers.
+ *
+ * Both buffers are rings: data is never relocated within the scratch buffer, so prepare and commit take time
+ * proportional to the data transferred, not to the amount of data buffered.
  */
 
 #include <string.h>
@@ -22,7 +25,8 @@ typedef struct {
     const size_t    scratch_capacity;
     uint8_t * const scratch;
     // mutable
-    size_t scratch_offset;
+    size_t scratch_start; // offset of the oldest byte not yet sent
+    size_t scratch_fill;  // number of bytes not yet sent
 } pipe_sender_t;
 
 typedef struct {
@@ -32,8 +36,8 @@ typedef struct {
     const size_t    scratch_capacity;
     uint8_t * const scratch;
     // mutable
-    size_t scratch_avail;
-    size_t scratch_offset;
+    size_t scratch_start; // offset of the next byte to read
+    size_t scratch_fill;  // number of bytes available to read
     pipe_txn_t pipe_txn;
 } pipe_receiver_t;
 
@@ -43,7 +47,8 @@ macro_define(PIPE_SENDER_REGISTER, s_ident, s_pipe, s_capacity, s_replica) {
         .pipe = &(s_pipe),
         .replica_id = (s_replica),
         .scratch_capacity = (s_capacity),
-        .scratch_offset = 0,
+        .scratch_start = 0,
+        .scratch_fill = 0,
         .scratch = symbol_join(s_ident, scratch_buffer),
     }
 }
@@ -54,12 +59,18 @@ macro_define(PIPE_RECEIVER_REGISTER, r_ident, r_pipe, r_capacity, r_replica) {
         .pipe = &(r_pipe),
         .replica_id = (r_replica),
         .scratch_capacity = (r_capacity),
-        .scratch_avail = 0,
-        .scratch_offset = 0,
+        .scratch_start = 0,
+        .scratch_fill = 0,
         .scratch = symbol_join(r_ident, scratch_buffer),
     }
 }
 
+// wraps an offset that may have run up to one buffer length past the end of the ring
+static inline size_t pipe_scratch_wrap(size_t capacity, size_t offset) {
+    assert(offset < 2 * capacity);
+    return offset >= capacity ? offset - capacity : offset;
+}
+
 void pipe_sender_reset(pipe_sender_t *s);
 void pipe_sender_prepare(pipe_sender_t *s);
 void pipe_sender_commit(pipe_sender_t *s);
@@ -67,28 +78,43 @@ void pipe_sender_commit(pipe_sender_t *s);
 static inline bool pipe_sender_reserve(pipe_sender_t *s, size_t length) {
     assert(s != NULL);
     assert(length <= s->scratch_capacity);
-    assert(s->scratch_offset <= s->scratch_capacity);
-    return s->scratch_offset + length <= s->scratch_capacity;
+    assert(s->scratch_fill <= s->scratch_capacity);
+    return s->scratch_fill + length <= s->scratch_capacity;
+}
+
+// returns the number of bytes that can currently be written without overflowing the scratch buffer.
+static inline size_t pipe_sender_space(pipe_sender_t *s) {
+    assert(s != NULL);
+    assert(s->scratch_fill <= s->scratch_capacity);
+    return s->scratch_capacity - s->scratch_fill;
 }
 
 static inline void pipe_sender_write_byte(pipe_sender_t *s, uint8_t byte) {
-    assert(s->scratch_offset < s->scratch_capacity);
-    s->scratch[s->scratch_offset++] = byte;
+    assert(s->scratch_fill < s->scratch_capacity);
+    s->scratch[pipe_scratch_wrap(s->scratch_capacity, s->scratch_start + s->scratch_fill)] = byte;
+    s->scratch_fill++;
 }
 
 static inline void pipe_sender_write(pipe_sender_t *s, void *data, size_t length) {
-    assert(s->scratch_offset + length <= s->scratch_capacity);
-    memcpy(&s->scratch[s->scratch_offset], data, length);
-    s->scratch_offset += length;
+    assert(s->scratch_fill + length <= s->scratch_capacity);
+    size_t end = pipe_scratch_wrap(s->scratch_capacity, s->scratch_start + s->scratch_fill);
+    size_t first = s->scratch_capacity - end;
+    if (first >= length) {
+        memcpy(&s->scratch[end], data, length);
+    } else {
+        memcpy(&s->scratch[end], data, first);
+        memcpy(s->scratch, (uint8_t *) data + first, length - first);
+    }
+    s->scratch_fill += length;
 }
 
 static inline size_t pipe_sender_write_partial(pipe_sender_t *s, void *data, size_t length) {
-    assert(s->scratch_offset <= s->scratch_capacity);
-    if (s->scratch_offset + length > s->scratch_capacity) {
-        length = s->scratch_capacity - s->scratch_offset;
+    assert(s->scratch_fill <= s->scratch_capacity);
+    if (s->scratch_fill + length > s->scratch_capacity) {
+        length = s->scratch_capacity - s->scratch_fill;
     }
     if (length > 0) {
-        memcpy(&s->scratch[s->scratch_offset], data, length);
+        pipe_sender_write(s, data, length);
     }
     return length;
 }
@@ -99,19 +125,22 @@ void pipe_receiver_commit(pipe_receiver_t *r);
 
 static inline bool pipe_receiver_has_next(pipe_receiver_t *r, size_t count) {
     assert(r != NULL);
-    assert(r->scratch_avail <= r->scratch_capacity);
-    assert(r->scratch_offset <= r->scratch_avail);
-    return r->scratch_offset + count <= r->scratch_avail;
+    assert(r->scratch_start < r->scratch_capacity);
+    assert(r->scratch_fill <= r->scratch_capacity);
+    return count <= r->scratch_fill;
 }
 
 static inline uint8_t pipe_receiver_read_byte(pipe_receiver_t *r) {
-    assert(r->scratch_offset < r->scratch_avail);
-    return r->scratch[r->scratch_offset++];
+    assert(r->scratch_fill > 0);
+    uint8_t byte = r->scratch[r->scratch_start];
+    r->scratch_start = pipe_scratch_wrap(r->scratch_capacity, r->scratch_start + 1);
+    r->scratch_fill--;
+    return byte;
 }
 
 static inline uint8_t pipe_receiver_peek_byte(pipe_receiver_t *r) {
-    assert(r->scratch_offset < r->scratch_avail);
-    return r->scratch[r->scratch_offset];
+    assert(r->scratch_fill > 0);
+    return r->scratch[r->scratch_start];
 }
 
 #endif /* FSW_SYNCH_PIPEBUF_H */
@@ -0,0 +1,469 @@
+#include <endian.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+#include <hal/clip.h>
+#include <hal/init.h>
+#include <hal/system.h>
+#include <hal/thread.h>
+#include <hal/timer.h>
+#include <bus/codec.h>
+#include <bus/rmap.h>
+#include <flight/clock.h>
+#include <flight/comm.h>
+#include <synch/circular.h>
+#include <synch/config.h>
+#include <synch/duct.h>
+#include <synch/pipe.h>
+#include <synch/pipebuf.h>
+
+/*
+ * Microbenchmarks for the synchronization primitives and bus codecs. Every operation is timed individually, and one
+ * JSON object is written per benchmark to the results file, so that runs can be compared mechanically.
+ */
+
+// must be a plain preprocessor constant for static_repeat
+#define BENCH_REPLICAS CONFIG_APPLICATION_REPLICAS
+
+enum {
+    BENCH_WARMUP     = 200,
+    BENCH_ITERATIONS = 20000,
+
+    BENCH_MAX_MESSAGE = 1024,
+    BENCH_DUCT_FLOW   = 4,
+
+    BENCH_PIPEBUF_CAPACITY = 2 * BENCH_MAX_MESSAGE,
+    BENCH_CODEC_BUFFER     = 4 * BENCH_MAX_MESSAGE,
+    BENCH_CIRC_BATCH       = 16,
+};
+
+// so that we don't need a full clock implementation for the clock functions
+int64_t clock_offset_adj_fast = 0;
+
+static FILE *bench_results = NULL;
+static uint64_t bench_samples[BENCH_ITERATIONS];
+
+enum bench_payload {
+    BENCH_PAYLOAD_ZEROS,   // best case: nothing needs escaping
+    BENCH_PAYLOAD_RANDOM,  // uniformly random bytes, with the occasional escape
+    BENCH_PAYLOAD_SPECIAL, // worst case: every byte needs escaping in both the FakeWire and comm encodings
+    BENCH_PAYLOAD_COUNT,
+};
+
+static const char *bench_payload_names[BENCH_PAYLOAD_COUNT] = {
+    [BENCH_PAYLOAD_ZEROS]   = "zeros",
+    [BENCH_PAYLOAD_RANDOM]  = "random",
+    [BENCH_PAYLOAD_SPECIAL] = "special",
+};
+
+static uint8_t bench_payloads[BENCH_PAYLOAD_COUNT][BENCH_MAX_MESSAGE];
+
+static void bench_init_payloads(void) {
+    srand48(27182);
+    for (size_t i = 0; i < BENCH_MAX_MESSAGE; i++) {
+        bench_payloads[BENCH_PAYLOAD_ZEROS][i] = 0;
+        bench_payloads[BENCH_PAYLOAD_RANDOM][i] = (uint8_t) lrand48();
+        // 0x80-0x87 are FakeWire control characters, and 0xFF is the comm escape byte
+        bench_payloads[BENCH_PAYLOAD_SPECIAL][i] = (i % 2 == 0) ? 0x81 : 0xFF;
+    }
+}
+
+static int bench_compare_samples(const void *a, const void *b) {
+    uint64_t sa = *(const uint64_t *) a, sb = *(const uint64_t *) b;
+    return (sa > sb) - (sa < sb);
+}
+
+// runs op repeatedly, and reports throughput and latency. bytes_per_op may be zero if throughput is meaningless.
+static void bench_run(const char *name, const char *variant, size_t bytes_per_op, void (*op)(void *), void *param) {
+    for (uint32_t i = 0; i < BENCH_WARMUP; i++) {
+        op(param);
+    }
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) {
+        local_time_t start = timer_host_now_ns();
+        op(param);
+        bench_samples[i] = timer_host_now_ns() - start;
+        total += bench_samples[i];
+    }
+    qsort(bench_samples, BENCH_ITERATIONS, sizeof(bench_samples[0]), bench_compare_samples);
+
+    double mean_ns = (double) total / BENCH_ITERATIONS;
+    double mb_per_s = (bytes_per_op > 0 && total > 0) ? (bytes_per_op * 1000.0 / mean_ns) : 0;
+    fprintf(bench_results, "{\"bench\": \"%s\", \"variant\": \"%s\", \"iterations\": %u, \"bytes_per_op\": %zu, "
+            "\"mean_ns\": %.1f, \"p50_ns\": %" PRIu64 ", \"p99_ns\": %" PRIu64 ", \"max_ns\": %" PRIu64 ", "
+            "\"mb_per_s\": %.2f}\n", name, variant, BENCH_ITERATIONS, bytes_per_op, mean_ns,
+            bench_samples[BENCH_ITERATIONS / 2], bench_samples[BENCH_ITERATIONS * 99 / 100],
+            bench_samples[BENCH_ITERATIONS - 1], mb_per_s);
+    fflush(bench_results);
+    debugf(INFO, "Benchmark %s[%s]: mean %.1f ns", name, variant, mean_ns);
+}
+
+// ducts: every sender replica sends a full flow, then every receiver replica votes on it.
+
+DUCT_REGISTER(bench_duct_1, 1, 1, BENCH_DUCT_FLOW, BENCH_MAX_MESSAGE, DUCT_SENDER_FIRST);
+DUCT_REGISTER(bench_duct_2, 2, 2, BENCH_DUCT_FLOW, BENCH_MAX_MESSAGE, DUCT_SENDER_FIRST);
+DUCT_REGISTER(bench_duct_3, 3, 3, BENCH_DUCT_FLOW, BENCH_MAX_MESSAGE, DUCT_SENDER_FIRST);
+
+struct bench_duct_param {
+    duct_t *duct;
+    uint8_t replicas;
+    size_t  message_size;
+};
+
+static void bench_duct_op(void *opaque) {
+    struct bench_duct_param *p = opaque;
+    duct_txn_t txn;
+    for (uint8_t r = 0; r < p->replicas; r++) {
+        duct_send_prepare(&txn, p->duct, r);
+        while (duct_send_allowed(&txn)) {
+            duct_send_message(&txn, bench_payloads[BENCH_PAYLOAD_RANDOM], p->message_size, 0);
+        }
+        duct_send_commit(&txn);
+    }
+    uint8_t buffer[BENCH_MAX_MESSAGE];
+    for (uint8_t r = 0; r < p->replicas; r++) {
+        duct_receive_prepare(&txn, p->duct, r);
+        while (duct_receive_message(&txn, buffer, NULL) > 0) {
+            // discard
+        }
+        duct_receive_commit(&txn);
+    }
+}
+
+static void bench_ducts(void) {
+    duct_t *ducts[] = { &bench_duct_1, &bench_duct_2, &bench_duct_3 };
+    const size_t sizes[] = { 16, 256, BENCH_MAX_MESSAGE };
+    for (uint8_t replicas = 1; replicas <= PP_ARRAY_SIZE(ducts); replicas++) {
+        for (size_t i = 0; i < PP_ARRAY_SIZE(sizes); i++) {
+            struct bench_duct_param param = {
+                .duct = ducts[replicas - 1],
+                .replicas = replicas,
+                .message_size = sizes[i],
+            };
+            char variant[64];
+            snprintf(variant, sizeof(variant), "replicas=%u,size=%zu", replicas, sizes[i]);
+            bench_run("duct", variant, sizes[i] * BENCH_DUCT_FLOW, bench_duct_op, &param);
+        }
+    }
+}
+
+// pipes: like ducts, but with backpressure.
+
+PIPE_REGISTER(bench_pipe, BENCH_REPLICAS, BENCH_REPLICAS, BENCH_DUCT_FLOW, BENCH_MAX_MESSAGE, PIPE_SENDER_FIRST);
+
+static void bench_pipe_op(void *opaque) {
+    size_t message_size = *(size_t *) opaque;
+    pipe_txn_t txn;
+    for (uint8_t r = 0; r < BENCH_REPLICAS; r++) {
+        pipe_send_prepare(&txn, &bench_pipe, r);
+        while (pipe_send_allowed(&txn)) {
+            pipe_send_message(&txn, bench_payloads[BENCH_PAYLOAD_RANDOM], message_size, 0);
+        }
+        pipe_send_commit(&txn);
+    }
+    for (uint8_t r = 0; r < BENCH_REPLICAS; r++) {
+        const uint8_t *message;
+        pipe_receive_prepare(&txn, &bench_pipe, r);
+        while (pipe_receive_borrow(&txn, &message, NULL) > 0) {
+            // discard
+        }
+        pipe_receive_commit(&txn, BENCH_DUCT_FLOW);
+    }
+}
+
+// pipe buffers: the sender side streams a fixed amount of data per epoch, which the receiver side drains entirely.
+
+PIPE_REGISTER(bench_pipebuf_pipe, BENCH_REPLICAS, BENCH_REPLICAS, BENCH_DUCT_FLOW, BENCH_MAX_MESSAGE,
+              PIPE_SENDER_FIRST);
+static_repeat(BENCH_REPLICAS, replica_id) {
+    PIPE_SENDER_REGISTER(symbol_join(bench_pipebuf_sender, replica_id), bench_pipebuf_pipe,
+                         BENCH_PIPEBUF_CAPACITY, replica_id);
+    PIPE_RECEIVER_REGISTER(symbol_join(bench_pipebuf_receiver, replica_id), bench_pipebuf_pipe,
+                           BENCH_PIPEBUF_CAPACITY, replica_id);
+}
+
+static pipe_sender_t *bench_pipebuf_senders[BENCH_REPLICAS] = {
+    static_repeat(BENCH_REPLICAS, replica_id) {
+        &symbol_join(bench_pipebuf_sender, replica_id),
+    }
+};
+
+static pipe_receiver_t *bench_pipebuf_receivers[BENCH_REPLICAS] = {
+    static_repeat(BENCH_REPLICAS, replica_id) {
+        &symbol_join(bench_pipebuf_receiver, replica_id),
+    }
+};
+
+static void bench_pipebuf_op(void *opaque) {
+    size_t chunk = *(size_t *) opaque;
+    for (uint8_t r = 0; r < BENCH_REPLICAS; r++) {
+        pipe_sender_t *s = bench_pipebuf_senders[r];
+        pipe_sender_prepare(s);
+        pipe_sender_write_partial(s, bench_payloads[BENCH_PAYLOAD_RANDOM], chunk);
+        pipe_sender_commit(s);
+    }
+    for (uint8_t r = 0; r < BENCH_REPLICAS; r++) {
+        pipe_receiver_t *rcv = bench_pipebuf_receivers[r];
+        pipe_receiver_prepare(rcv);
+        while (pipe_receiver_has_next(rcv, 1)) {
+            (void) pipe_receiver_read_byte(rcv);
+        }
+        pipe_receiver_commit(rcv);
+    }
+}
+
+static void bench_pipes(void) {
+    const size_t sizes[] = { 64, BENCH_MAX_MESSAGE };
+    for (size_t i = 0; i < PP_ARRAY_SIZE(sizes); i++) {
+        char variant[64];
+        snprintf(variant, sizeof(variant), "replicas=%u,size=%zu", BENCH_REPLICAS, sizes[i]);
+        bench_run("pipe", variant, sizes[i] * BENCH_DUCT_FLOW, bench_pipe_op, (void *) &sizes[i]);
+        bench_run("pipebuf", variant, sizes[i], bench_pipebuf_op, (void *) &sizes[i]);
+    }
+}
+
+// circular buffers: a batch of elements is written and then read back.
+
+CIRC_BUF_REGISTER(bench_circ, 64, 256);
+
+static void bench_circ_op(void *opaque) {
+    (void) opaque;
+    for (circ_index_t i = 0; i < BENCH_CIRC_BATCH; i++) {
+        assert(circ_buf_write_avail(&bench_circ) > i);
+        memcpy(circ_buf_write_peek(&bench_circ, i), bench_payloads[BENCH_PAYLOAD_RANDOM], 64);
+    }
+    circ_buf_write_done(&bench_circ, BENCH_CIRC_BATCH);
+    uint8_t element[64];
+    for (circ_index_t i = 0; i < BENCH_CIRC_BATCH; i++) {
+        assert(circ_buf_read_avail(&bench_circ) > i);
+        memcpy(element, circ_buf_read_peek(&bench_circ, i), sizeof(element));
+    }
+    circ_buf_read_done(&bench_circ, BENCH_CIRC_BATCH);
+}
+
+static void bench_circ_spans_op(void *opaque) {
+    (void) opaque;
+    circ_span_t spans[2];
+    size_t num_spans = circ_buf_write_peek_spans(&bench_circ, BENCH_CIRC_BATCH, spans);
+    for (size_t s = 0; s < num_spans; s++) {
+        for (circ_index_t i = 0; i < spans[s].count; i++) {
+            memcpy((uint8_t *) spans[s].elements + 64 * i, bench_payloads[BENCH_PAYLOAD_RANDOM], 64);
+        }
+    }
+    circ_buf_write_done(&bench_circ, BENCH_CIRC_BATCH);
+    uint8_t element[64];
+    num_spans = circ_buf_read_peek_spans(&bench_circ, BENCH_CIRC_BATCH, spans);
+    for (size_t s = 0; s < num_spans; s++) {
+        for (circ_index_t i = 0; i < spans[s].count; i++) {
+            memcpy(element, (uint8_t *) spans[s].elements + 64 * i, sizeof(element));
+        }
+    }
+    circ_buf_read_done(&bench_circ, BENCH_CIRC_BATCH);
+}
+
+static void bench_circ_bufs(void) {
+    circ_buf_reset(&bench_circ);
+    bench_run("circ_buf", "elem=64,batch=16", 64 * BENCH_CIRC_BATCH, bench_circ_op, NULL);
+    circ_buf_reset(&bench_circ);
+    bench_run("circ_buf_spans", "elem=64,batch=16", 64 * BENCH_CIRC_BATCH, bench_circ_spans_op, NULL);
+}
+
+// FakeWire codec: a packet is encoded into a duct, and then decoded back out of it.
+
+DUCT_REGISTER(bench_fw_duct, 1, 1, 1, BENCH_CODEC_BUFFER, DUCT_SENDER_FIRST);
+FAKEWIRE_ENCODER_REGISTER(bench_fw_encoder, bench_fw_duct, 0, BENCH_CODEC_BUFFER);
+FAKEWIRE_DECODER_REGISTER(bench_fw_decoder, bench_fw_duct, 0, BENCH_CODEC_BUFFER);
+
+static fw_decoder_synch_t bench_fw_synch;
+
+static void bench_fakewire_op(void *opaque) {
+    const uint8_t *payload = opaque;
+    fakewire_enc_prepare(&bench_fw_encoder);
+    fakewire_enc_encode_ctrl(&bench_fw_encoder, FWC_START_PACKET, 0);
+    size_t written = fakewire_enc_encode_data(&bench_fw_encoder, payload, BENCH_MAX_MESSAGE);
+    assert(written == BENCH_MAX_MESSAGE);
+    fakewire_enc_encode_ctrl(&bench_fw_encoder, FWC_END_PACKET, 0);
+    fakewire_enc_commit(&bench_fw_encoder);
+
+    uint8_t buffer[BENCH_MAX_MESSAGE];
+    fw_decoded_ent_t decoded = {
+        .data_out = buffer,
+        .data_max_len = sizeof(buffer),
+    };
+    fakewire_dec_prepare(&bench_fw_decoder);
+    while (fakewire_dec_decode(&bench_fw_decoder, &bench_fw_synch, &decoded)) {
+        // discard
+    }
+    fakewire_dec_commit(&bench_fw_decoder);
+}
+
+static void bench_fakewire(void) {
+    fakewire_dec_reset(&bench_fw_decoder, &bench_fw_synch);
+    for (int p = 0; p < BENCH_PAYLOAD_COUNT; p++) {
+        bench_run("fakewire_codec", bench_payload_names[p], BENCH_MAX_MESSAGE, bench_fakewire_op, bench_payloads[p]);
+    }
+}
+
+// RMAP CRC
+
+static void bench_rmap_crc_op(void *opaque) {
+    static volatile uint8_t sink;
+    sink = rmap_crc8_extend(sink, opaque, BENCH_MAX_MESSAGE);
+}
+
+static void bench_rmap_crc(void) {
+    bench_run("rmap_crc8", "size=1024", BENCH_MAX_MESSAGE, bench_rmap_crc_op, bench_payloads[BENCH_PAYLOAD_RANDOM]);
+}
+
+// comm codec: telemetry-sized packets are encoded into a downlink pipe, and command packets of the same size are
+// decoded from an uplink pipe. (the two directions use different magic numbers, so they cannot be chained.)
+
+enum {
+    BENCH_COMM_PACKET      = 256,
+    BENCH_COMM_MAGIC       = 0x73133C2C, // must match COMM_CMD_MAGIC_NUM
+    BENCH_COMM_ESCAPE      = 0xFF,
+    BENCH_COMM_FRAME_LIMIT = 2 * (BENCH_COMM_PACKET + 20) + 4,
+};
+
+PIPE_REGISTER(bench_comm_downlink, 1, 1, 2, BENCH_MAX_MESSAGE, PIPE_SENDER_FIRST);
+COMM_ENC_REGISTER(bench_comm_encoder, bench_comm_downlink, 0);
+PIPE_RECEIVER_REGISTER(bench_comm_drain, bench_comm_downlink, COMM_SCRATCH_SIZE, 0);
+
+PIPE_REGISTER(bench_comm_uplink, 1, 1, 2, BENCH_MAX_MESSAGE, PIPE_SENDER_FIRST);
+PIPE_SENDER_REGISTER(bench_comm_feed, bench_comm_uplink, COMM_SCRATCH_SIZE, 0);
+COMM_DEC_REGISTER(bench_comm_decoder, bench_comm_uplink, 0);
+
+struct bench_comm_frame {
+    size_t  length;
+    uint8_t bytes[BENCH_COMM_FRAME_LIMIT];
+};
+
+static void bench_comm_frame_escaped(struct bench_comm_frame *frame, const uint8_t *data, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        assert(frame->length + 2 <= sizeof(frame->bytes));
+        frame->bytes[frame->length++] = data[i];
+        if (data[i] == BENCH_COMM_ESCAPE) {
+            frame->bytes[frame->length++] = 0x11;
+        }
+    }
+}
+
+// builds an uplink command frame independently of the encoder under test
+static void bench_comm_frame_command(struct bench_comm_frame *frame, const uint8_t *body) {
+    uint8_t header[16];
+    *(uint32_t *) &header[0] = htobe32(BENCH_COMM_MAGIC);
+    *(uint32_t *) &header[4] = htobe32(0x01000001);
+    *(uint64_t *) &header[8] = htobe64(0);
+    uint32_t crc = crc32(crc32(0, header, sizeof(header)), body, BENCH_COMM_PACKET);
+    crc = htobe32(crc);
+
+    frame->length = 0;
+    frame->bytes[frame->length++] = BENCH_COMM_ESCAPE;
+    frame->bytes[frame->length++] = 0x22;
+    bench_comm_frame_escaped(frame, header, sizeof(header));
+    bench_comm_frame_escaped(frame, body, BENCH_COMM_PACKET);
+    bench_comm_frame_escaped(frame, (uint8_t *) &crc, sizeof(crc));
+    frame->bytes[frame->length++] = BENCH_COMM_ESCAPE;
+    frame->bytes[frame->length++] = 0x33;
+}
+
+static void bench_comm_encode_op(void *opaque) {
+    comm_packet_t packet = {
+        .cmd_tlm_id = 0x01000001,
+        .timestamp_ns = 0,
+        .data_len = BENCH_COMM_PACKET,
+        .data_bytes = opaque,
+    };
+    comm_enc_prepare(&bench_comm_encoder);
+    bool encoded = comm_enc_encode(&bench_comm_encoder, &packet);
+    assert(encoded);
+    comm_enc_commit(&bench_comm_encoder);
+
+    pipe_receiver_prepare(&bench_comm_drain);
+    while (pipe_receiver_has_next(&bench_comm_drain, 1)) {
+        (void) pipe_receiver_read_byte(&bench_comm_drain);
+    }
+    pipe_receiver_commit(&bench_comm_drain);
+}
+
+static uint32_t bench_comm_decoded;
+
+static void bench_comm_decode_op(void *opaque) {
+    struct bench_comm_frame *frame = opaque;
+    pipe_sender_prepare(&bench_comm_feed);
+    if (pipe_sender_reserve(&bench_comm_feed, frame->length)) {
+        pipe_sender_write(&bench_comm_feed, frame->bytes, frame->length);
+    }
+    pipe_sender_commit(&bench_comm_feed);
+
+    comm_packet_t decoded;
+    comm_dec_prepare(&bench_comm_decoder);
+    while (comm_dec_decode(&bench_comm_decoder, &decoded)) {
+        assert(decoded.data_len == BENCH_COMM_PACKET);
+        bench_comm_decoded++;
+    }
+    comm_dec_commit(&bench_comm_decoder);
+}
+
+static void bench_comm(void) {
+    comm_enc_reset(&bench_comm_encoder);
+    pipe_receiver_reset(&bench_comm_drain);
+    pipe_sender_reset(&bench_comm_feed);
+    comm_dec_reset(&bench_comm_decoder);
+    for (int p = 0; p < BENCH_PAYLOAD_COUNT; p++) {
+        bench_run("comm_encode", bench_payload_names[p], BENCH_COMM_PACKET,
+                  bench_comm_encode_op, bench_payloads[p]);
+    }
+    for (int p = 0; p < BENCH_PAYLOAD_COUNT; p++) {
+        struct bench_comm_frame frame;
+        bench_comm_frame_command(&frame, bench_payloads[p]);
+        bench_comm_decoded = 0;
+        bench_run("comm_decode", bench_payload_names[p], BENCH_COMM_PACKET, bench_comm_decode_op, &frame);
+        assertf(bench_comm_decoded > 0, "no packets decoded during comm_decode benchmark");
+    }
+}
+
+static void bench_main_clip(void) {
+    bench_init_payloads();
+
+    bench_ducts();
+    bench_pipes();
+    bench_circ_bufs();
+    bench_fakewire();
+    bench_rmap_crc();
+    bench_comm();
+
+    fclose(bench_results);
+    debugf(INFO, "Benchmarks complete!");
+    exit(0);
+}
+
+// the benchmarks run within a clip, because duct receives must.
+CLIP_REGISTER(bench_clip, bench_main_clip, NULL);
+
+SCHEDULE_PARTITION_ORDER() {
+    CLIP_SCHEDULE(bench_clip, 1000)
+    SYSTEM_MAINTENANCE_SCHEDULE()
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s <results.jsonl>\n", argv[0]);
+        return 1;
+    }
+
+    bench_results = fopen(argv[1], "w");
+    if (bench_results == NULL) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    initialize_systems();
+    enter_scheduler();
+
+    // exit just the main thread, because returning causes all threads to exit, and we want everything to keep running
+    pthread_exit(NULL);
+}
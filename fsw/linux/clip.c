@@ -1,3 +1,6 @@
+#include <inttypes.h>
+#include <stdio.h>
+
 #include <hal/clip.h>
 #include <synch/strict.h>
 
@@ -13,8 +16,15 @@ void clip_loop(clip_t *clip) {
                          clip->label, now, current_tick);
         }
 
+        // measured on the host clock, because the virtual clock does not advance during a clip
+        local_time_t start_ns = timer_host_now_ns();
+
         clip->clip_play(clip->clip_argument);
 
+        uint32_t position = task_get_current()->sched_position;
+        profile_record(&task_scheduling_profiles[position], task_scheduling_order[position].nanos,
+                       timer_host_now_ns() - start_ns, task_tick_index() != current_tick);
+
         if (current_tick != (now = task_tick_index())) {
             malfunctionf("Clip %s overran scheduling period. Tick found to be %u instead of %u.",
                          clip->label, now, current_tick);
@@ -26,3 +36,112 @@ void clip_loop(clip_t *clip) {
         current_tick++;
     }
 }
+
+uint32_t clip_profile_partitions(void) {
+    return task_scheduling_order_length;
+}
+
+bool clip_profile_summary(uint32_t partition, profile_summary_t *out, const char **label_out) {
+    assert(out != NULL);
+    if (partition >= task_scheduling_order_length) {
+        return false;
+    }
+    profile_summarize(&task_scheduling_profiles[partition], task_scheduling_order[partition].nanos, out);
+    if (label_out != NULL) {
+        *label_out = task_get_name(task_scheduling_order[partition].task);
+    }
+    return true;
+}
+
+#define PROFILE_US(ns) (ns) / 1000, (ns) % 1000
+
+void clip_profile_export(const char *path) {
+    assert(path != NULL);
+    char temp_path[256];
+    int length = snprintf(temp_path, sizeof(temp_path), "%s.tmp", path);
+    assert(length > 0 && (size_t) length < sizeof(temp_path));
+
+    // written to a temporary file first, so that readers never see a partial profile
+    FILE *out = fopen(temp_path, "w");
+    if (out == NULL) {
+        debugf(WARNING, "Could not open clip profile file %s for writing.", temp_path);
+        return;
+    }
+    fprintf(out, "# partition task budget_us runs overruns min_us mean_us p99_us max_us histogram[%u per budget]\n",
+            PROFILE_BUCKETS_PER_BUDGET);
+    for (uint32_t i = 0; i < task_scheduling_order_length; i++) {
+        profile_summary_t summary;
+        const char *label = NULL;
+        bool ok = clip_profile_summary(i, &summary, &label);
+        assert(ok);
+        fprintf(out, "%" PRIu32 " %s %" PRIu32 ".%03" PRIu32 " %" PRIu32 " %" PRIu32
+                " %" PRIu32 ".%03" PRIu32 " %" PRIu32 ".%03" PRIu32 " %" PRIu32 ".%03" PRIu32 " %" PRIu32 ".%03" PRIu32,
+                i, label, PROFILE_US(task_scheduling_order[i].nanos), summary.runs, summary.overruns,
+                PROFILE_US(summary.min_ns), PROFILE_US(summary.mean_ns),
+                PROFILE_US(summary.p99_ns), PROFILE_US(summary.max_ns));
+        for (uint32_t bucket = 0; bucket < PROFILE_BUCKETS; bucket++) {
+            fprintf(out, "%c%" PRIu32, bucket == 0 ? ' ' : ',', task_scheduling_profiles[i].histogram[bucket]);
+        }
+        fputc('\n', out);
+    }
+    if (fclose(out) != 0 || rename(temp_path, path) != 0) {
+        debugf(WARNING, "Could not write clip profile file %s.", path);
+    }
+}
+
+#if ( LINUX_PARALLEL_CLIPS == 1 )
+
+bool clip_learning = false;
+
+struct clip_access_record {
+    const void      *resource;
+    enum clip_access access;
+};
+
+void clip_record_access(const void *resource, enum clip_access access) {
+    thread_t task = task_get_current();
+    // only accesses made while holding the schedule matter for planning; independent tasks never run in waves.
+    if (atomic_load(task->scheduler_independent)) {
+        return;
+    }
+    if (access == CLIP_ACCESS_BARRIER) {
+        task->access_barrier = true;
+        return;
+    }
+    for (size_t i = 0; i < task->num_accesses; i++) {
+        if (task->accesses[i].resource == resource && task->accesses[i].access == access) {
+            return;
+        }
+    }
+    if (task->num_accesses == task->max_accesses) {
+        task->max_accesses = task->max_accesses ? task->max_accesses * 2 : 8;
+        task->accesses = realloc(task->accesses, sizeof(task->accesses[0]) * task->max_accesses);
+        assert(task->accesses != NULL);
+    }
+    task->accesses[task->num_accesses++] = (struct clip_access_record) {
+        .resource = resource,
+        .access   = access,
+    };
+}
+
+static bool clip_access_conflicts(struct clip_access_record *a, struct clip_access_record *b) {
+    return a->resource == b->resource
+        && (a->access != b->access || a->access == CLIP_ACCESS_EXCLUSIVE);
+}
+
+bool clip_tasks_conflict(thread_t a, thread_t b) {
+    assert(a != NULL && b != NULL);
+    if (a == b || a->access_barrier || b->access_barrier) {
+        return true;
+    }
+    for (size_t i = 0; i < a->num_accesses; i++) {
+        for (size_t j = 0; j < b->num_accesses; j++) {
+            if (clip_access_conflicts(&a->accesses[i], &b->accesses[j])) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+#endif
@@ -0,0 +1,403 @@
+#include <pthread.h>
+#include <semaphore.h>
+#include <stddef.h>
+#include <unistd.h>
+
+#include <hal/atomic.h>
+#include <hal/debug.h>
+#include <hal/thread.h>
+
+enum {
+    // capacity of each per-thread ring; must be a power of two
+    DEBUG_RING_SIZE = 64 * 1024,
+    // maximum length of a single encoded message; longer messages have their string arguments truncated
+    DEBUG_RECORD_MAX = 1024,
+};
+static_assert((DEBUG_RING_SIZE & (DEBUG_RING_SIZE - 1)) == 0, "ring size must be a power of two");
+
+// each record in a ring consists of a 32-bit length, followed by the concatenated data sequences passed to
+// debugf_internal. the first sequence always starts with the metadata pointer and the timestamp.
+struct debug_ring {
+    uint32_t head;    // only advanced by the owning thread
+    uint32_t tail;    // only advanced while holding debug_drain_lock
+    uint32_t dropped; // count of messages discarded because the ring was full
+    struct debug_ring *next;
+    uint8_t data[DEBUG_RING_SIZE];
+};
+
+struct debug_record_header {
+    const struct debugf_metadata *metadata;
+    uint64_t timestamp;
+} __attribute__((packed));
+
+// parsed representation of a single printf conversion specification
+struct debug_spec {
+    char   text[32]; // the specification itself, with any dynamic widths left as '*'
+    size_t num_dynamic;
+    char   kind;     // 'i' for integers, 'f' for doubles, or the specifier character for 'c', 's', and 'p'
+    size_t size;     // number of bytes taken by the argument in the record, or 0 for strings
+};
+
+static __thread struct debug_ring *debug_local_ring = NULL;
+
+// rings are only ever prepended to this list, and are never freed.
+static struct debug_ring *debug_rings = NULL;
+static pthread_mutex_t debug_register_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t debug_drain_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t debug_drain_once = PTHREAD_ONCE_INIT;
+// set by the drain thread before it sleeps on debug_drain_wake, and cleared by whichever writer posts it
+static bool debug_drain_idle = false;
+static sem_t debug_drain_wake;
+
+static void debug_ring_write(struct debug_ring *ring, uint32_t offset, const void *data, size_t length) {
+    size_t start = offset & (DEBUG_RING_SIZE - 1);
+    size_t first = DEBUG_RING_SIZE - start;
+    if (first > length) {
+        first = length;
+    }
+    memcpy(&ring->data[start], data, first);
+    memcpy(&ring->data[0], (const uint8_t *) data + first, length - first);
+}
+
+static void debug_ring_read(struct debug_ring *ring, uint32_t offset, void *data, size_t length) {
+    size_t start = offset & (DEBUG_RING_SIZE - 1);
+    size_t first = DEBUG_RING_SIZE - start;
+    if (first > length) {
+        first = length;
+    }
+    memcpy(data, &ring->data[start], first);
+    memcpy((uint8_t *) data + first, &ring->data[0], length - first);
+}
+
+// mirrors parse_printf_format in the debugf_core python macro, which determines how arguments are laid out.
+static const char *debug_parse_spec(const char *format, struct debug_spec *spec) {
+    size_t len = 0;
+    spec->num_dynamic = 0;
+    spec->text[len++] = '%';
+    // skip flags
+    while (*format && strchr("0-+ #", *format) != NULL && len < sizeof(spec->text) - 8) {
+        spec->text[len++] = *format++;
+    }
+    // width and precision
+    for (int part = 0; part < 2; part++) {
+        if (part == 1) {
+            if (*format != '.') {
+                break;
+            }
+            spec->text[len++] = *format++;
+        }
+        if (*format == '*') {
+            spec->text[len++] = *format++;
+            spec->num_dynamic++;
+        } else {
+            while (*format >= '0' && *format <= '9' && len < sizeof(spec->text) - 6) {
+                spec->text[len++] = *format++;
+            }
+        }
+    }
+    // length field
+    spec->size = sizeof(unsigned int);
+    if (*format == 'l') {
+        spec->text[len++] = *format++;
+        if (*format == 'l') {
+            spec->text[len++] = *format++;
+            spec->size = sizeof(unsigned long long);
+        } else {
+            spec->size = sizeof(unsigned long);
+        }
+    } else if (*format == 'h') {
+        spec->text[len++] = *format++;
+        if (*format == 'h') {
+            spec->text[len++] = *format++;
+            spec->size = sizeof(unsigned char);
+        } else {
+            spec->size = sizeof(unsigned short);
+        }
+    } else if (*format == 't' || *format == 'j' || *format == 'z') {
+        spec->text[len++] = *format;
+        spec->size = (*format == 't') ? sizeof(ptrdiff_t) : (*format == 'j') ? sizeof(intmax_t) : sizeof(size_t);
+        format++;
+    }
+    // specifier
+    if (*format == '\0') {
+        return NULL;
+    } else if (strchr("diuxXob", *format) != NULL) {
+        spec->kind = 'i';
+    } else if (strchr("fFeEgG", *format) != NULL) {
+        spec->kind = 'f';
+        spec->size = sizeof(double);
+    } else if (*format == 'c') {
+        spec->kind = 'c';
+        spec->size = sizeof(unsigned char);
+    } else if (*format == 's') {
+        spec->kind = 's';
+        spec->size = 0;
+    } else if (*format == 'p') {
+        spec->kind = 'p';
+        spec->size = sizeof(const void *);
+    } else {
+        return NULL;
+    }
+    spec->text[len++] = *format++;
+    spec->text[len] = '\0';
+    return format;
+}
+
+static void debug_render(FILE *out, const uint8_t *record, size_t length) {
+    struct debug_record_header header;
+    assert(length >= sizeof(header));
+    memcpy(&header, record, sizeof(header));
+    const char *format = header.metadata->format;
+
+    // first pass: find where the string arguments begin
+    size_t strings_offset = sizeof(header);
+    struct debug_spec spec;
+    for (const char *f = format; *f; ) {
+        if (*f++ != '%') {
+            continue;
+        } else if (*f == '%') {
+            f++;
+            continue;
+        }
+        if ((f = debug_parse_spec(f, &spec)) == NULL) {
+            break;
+        }
+        strings_offset += spec.num_dynamic * sizeof(unsigned int) + spec.size;
+    }
+
+    fprintf(out, "[" TIMEFMT "] ", TIMEARG(header.timestamp));
+
+    // second pass: render each argument in turn
+    size_t arg_offset = sizeof(header);
+    size_t string_offset = strings_offset;
+    const char *f = format;
+    while (*f) {
+        const char *next = strchr(f, '%');
+        if (next == NULL) {
+            fputs(f, out);
+            break;
+        }
+        fwrite(f, 1, next - f, out);
+        f = next + 1;
+        if (*f == '%') {
+            fputc('%', out);
+            f++;
+            continue;
+        }
+        if ((f = debug_parse_spec(f, &spec)) == NULL
+                || strings_offset > length
+                || arg_offset + spec.num_dynamic * sizeof(unsigned int) + spec.size > strings_offset) {
+            fputs("<malformed>", out);
+            break;
+        }
+        // substitute dynamic widths and precisions directly into the specification
+        char text[sizeof(spec.text) + 24];
+        size_t text_len = 0;
+        for (const char *s = spec.text; *s; s++) {
+            if (*s == '*') {
+                unsigned int dynamic;
+                memcpy(&dynamic, &record[arg_offset], sizeof(dynamic));
+                arg_offset += sizeof(dynamic);
+                text_len += snprintf(&text[text_len], sizeof(text) - text_len, "%d", (int) dynamic);
+            } else {
+                text[text_len++] = *s;
+            }
+        }
+        text[text_len] = '\0';
+
+        if (spec.kind == 's') {
+            size_t available = length - string_offset;
+            const char *str = (const char *) &record[string_offset];
+            size_t str_len = strnlen(str, available);
+            fprintf(out, text, strndupa(str, str_len));
+            string_offset += str_len + (str_len < available ? 1 : 0);
+        } else if (spec.kind == 'f') {
+            double value;
+            memcpy(&value, &record[arg_offset], sizeof(value));
+            fprintf(out, text, value);
+        } else if (spec.kind == 'p') {
+            const void *value;
+            memcpy(&value, &record[arg_offset], sizeof(value));
+            fprintf(out, text, value);
+        } else if (spec.size == sizeof(unsigned long long)) {
+            unsigned long long value;
+            memcpy(&value, &record[arg_offset], sizeof(value));
+            fprintf(out, text, value);
+        } else {
+            unsigned int value = 0;
+            if (spec.size == sizeof(unsigned char)) {
+                value = record[arg_offset];
+            } else if (spec.size == sizeof(unsigned short)) {
+                unsigned short shortval;
+                memcpy(&shortval, &record[arg_offset], sizeof(shortval));
+                value = shortval;
+            } else {
+                assert(spec.size == sizeof(unsigned int));
+                memcpy(&value, &record[arg_offset], sizeof(value));
+            }
+            fprintf(out, text, value);
+        }
+        arg_offset += spec.size;
+    }
+    fputc('\n', out);
+}
+
+// renders every queued message, interleaving threads in timestamp order. returns true if any were found.
+static bool debug_drain_locked(FILE *out) {
+    uint8_t record[DEBUG_RECORD_MAX];
+    bool any = false;
+
+    for (struct debug_ring *ring = atomic_load(debug_rings); ring != NULL; ring = ring->next) {
+        uint32_t dropped = atomic_exchange(ring->dropped, 0);
+        if (dropped > 0) {
+            fprintf(out, "[debug] %u messages dropped because a log ring was full\n", dropped);
+            any = true;
+        }
+    }
+
+    for (;;) {
+        struct debug_ring *best = NULL;
+        uint64_t best_timestamp = 0;
+        for (struct debug_ring *ring = atomic_load(debug_rings); ring != NULL; ring = ring->next) {
+            if (ring->tail == atomic_load(ring->head)) {
+                continue;
+            }
+            struct debug_record_header header;
+            debug_ring_read(ring, ring->tail + sizeof(uint32_t), &header, sizeof(header));
+            if (best == NULL || header.timestamp < best_timestamp) {
+                best = ring;
+                best_timestamp = header.timestamp;
+            }
+        }
+        if (best == NULL) {
+            return any;
+        }
+        uint32_t length;
+        debug_ring_read(best, best->tail, &length, sizeof(length));
+        assert(length >= sizeof(struct debug_record_header) && length <= DEBUG_RECORD_MAX);
+        debug_ring_read(best, best->tail + sizeof(length), record, length);
+        atomic_store(best->tail, best->tail + sizeof(length) + length);
+
+        debug_render(out, record, length);
+        any = true;
+    }
+}
+
+static void debug_drain(void) {
+    THREAD_CHECK(pthread_mutex_lock(&debug_drain_lock));
+    if (debug_drain_locked(stdout)) {
+        fflush(stdout);
+    }
+    THREAD_CHECK(pthread_mutex_unlock(&debug_drain_lock));
+}
+
+static bool debug_rings_pending(void) {
+    for (struct debug_ring *ring = atomic_load(debug_rings); ring != NULL; ring = ring->next) {
+        if (atomic_load(ring->tail) != atomic_load(ring->head) || atomic_load(ring->dropped) > 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void *debug_drain_loop(void *param) {
+    (void) param;
+    for (;;) {
+        THREAD_CHECK(pthread_mutex_lock(&debug_drain_lock));
+        bool any = debug_drain_locked(stdout);
+        if (any) {
+            fflush(stdout);
+        }
+        THREAD_CHECK(pthread_mutex_unlock(&debug_drain_lock));
+        if (any) {
+            continue;
+        }
+        // writers wake us once they record another message; check once more in case one already did
+        atomic_store(debug_drain_idle, true);
+        atomic_fence();
+        if (debug_rings_pending()) {
+            atomic_store(debug_drain_idle, false);
+            continue;
+        }
+        while (sem_wait(&debug_drain_wake) < 0) {
+            if (errno != EINTR) {
+                perror("sem_wait");
+                abort();
+            }
+        }
+    }
+    return NULL;
+}
+
+static void debug_start_drain(void) {
+    THREAD_CHECK(sem_init(&debug_drain_wake, 0, 0));
+    pthread_t drain_thread;
+    THREAD_CHECK(pthread_create(&drain_thread, NULL, debug_drain_loop, NULL));
+    THREAD_CHECK(pthread_detach(drain_thread));
+    THREAD_CHECK(atexit(debug_drain));
+}
+
+static struct debug_ring *debug_ring_create(void) {
+    THREAD_CHECK(pthread_once(&debug_drain_once, debug_start_drain));
+
+    struct debug_ring *ring = calloc(1, sizeof(struct debug_ring));
+    if (ring == NULL) {
+        perror("calloc");
+        abort();
+    }
+    THREAD_CHECK(pthread_mutex_lock(&debug_register_lock));
+    ring->next = debug_rings;
+    atomic_store(debug_rings, ring);
+    THREAD_CHECK(pthread_mutex_unlock(&debug_register_lock));
+    return ring;
+}
+
+void debugf_internal(const void **data_sequences, const size_t *data_sizes, size_t data_num) {
+    assert(data_num >= 1 && data_sizes[0] >= sizeof(struct debug_record_header));
+    struct debug_ring *ring = debug_local_ring;
+    if (ring == NULL) {
+        ring = debug_local_ring = debug_ring_create();
+    }
+    struct debug_record_header header;
+    memcpy(&header, data_sequences[0], sizeof(header));
+    bool critical = (header.metadata->loglevel == CRITICAL);
+    if (critical) {
+        // make room, and make sure everything before this message is printed first. this is also what keeps the
+        // messages leading up to an assertf or abortf from being lost, because nothing is drained after abort().
+        debug_drain();
+    }
+
+    uint32_t length = 0;
+    for (size_t i = 0; i < data_num; i++) {
+        length += data_sizes[i];
+    }
+    if (length > DEBUG_RECORD_MAX) {
+        length = DEBUG_RECORD_MAX;
+    }
+
+    uint32_t head = ring->head;
+    if (DEBUG_RING_SIZE - (head - atomic_load(ring->tail)) < sizeof(length) + length) {
+        atomic_fetch_add(ring->dropped, 1);
+    } else {
+        debug_ring_write(ring, head, &length, sizeof(length));
+        uint32_t offset = sizeof(length);
+        for (size_t i = 0; i < data_num && offset < sizeof(length) + length; i++) {
+            size_t size = data_sizes[i];
+            if (size > sizeof(length) + length - offset) {
+                size = sizeof(length) + length - offset;
+            }
+            debug_ring_write(ring, head + offset, data_sequences[i], size);
+            offset += size;
+        }
+        atomic_store(ring->head, head + offset);
+    }
+
+    if (critical) {
+        debug_drain();
+    } else {
+        atomic_fence();
+        if (atomic_load(debug_drain_idle) && atomic_exchange(debug_drain_idle, false)) {
+            THREAD_CHECK(sem_post(&debug_drain_wake));
+        }
+    }
+}
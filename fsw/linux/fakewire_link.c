@@ -1,11 +1,17 @@
 #include <assert.h>
 #include <fcntl.h>
+#include <inttypes.h>
 #include <signal.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <string.h>
 #include <termios.h>
 #include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
 
 #include <hal/debug.h>
 #include <hal/timer.h>
@@ -15,10 +21,222 @@
 
 enum {
     REPLICA_ID = 0,
+    // maximum number of readiness events handled per wakeup of the I/O thread
+    FW_LINK_IO_EVENTS = 16,
+    // how often a shared-memory consumer checks whether the producer has created the file yet
+    FW_LINK_SHM_POLL_US = 1000,
+    // stored last by the producer, once the rest of the header is filled in
+    FW_LINK_SHM_MAGIC = 0x4657534D, // "FWSM"
+};
+
+// layout of the file mapped by both ends of a shared-memory link
+struct fw_link_shm {
+    fw_link_ring_indices_t p2c;
+    fw_link_ring_indices_t c2p;
+    uint32_t magic;
+    uint32_t producer_pid;
+    uint64_t generation; // distinct for every run of the producer
+    uint64_t capacity; // of each ring
+    // the producer-to-consumer ring, then the consumer-to-producer ring
+    uint8_t data[] __attribute__((__aligned__(64)));
 };
 
 #define debug_printf(lvl,fmt, ...) (debugf(lvl, "[%s] " fmt, fwl->options.label, ## __VA_ARGS__))
 
+// a single thread performs every read and write for all links in the process, sleeping in epoll_wait until a
+// descriptor becomes ready or a clip wakes it through fw_link_wake_fd. links are only ever prepended to this list.
+static fw_link_t *fw_link_io_links = NULL;
+static pthread_mutex_t fw_link_io_register_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t fw_link_io_once = PTHREAD_ONCE_INIT;
+static int fw_link_epoll_fd = -1;
+static int fw_link_wake_fd = -1;
+
+// fills in up to two iovecs describing 'length' bytes of the ring starting at the free-running offset 'offset'.
+static int fw_link_ring_spans(fw_link_ring_t *ring, size_t offset, size_t length, struct iovec spans[2]) {
+    size_t start = offset % ring->capacity;
+    size_t first = ring->capacity - start;
+    if (first >= length) {
+        spans[0] = (struct iovec) { .iov_base = &ring->storage[start], .iov_len = length };
+        return 1;
+    }
+    spans[0] = (struct iovec) { .iov_base = &ring->storage[start], .iov_len = first };
+    spans[1] = (struct iovec) { .iov_base = &ring->storage[0], .iov_len = length - first };
+    return 2;
+}
+
+static void fw_link_io_wake(void) {
+    uint64_t one = 1;
+    if (write(fw_link_wake_fd, &one, sizeof(one)) != sizeof(one) && errno != EAGAIN) {
+        perror("write");
+        abortf("Failed to wake fakewire link I/O thread.");
+    }
+}
+
+static void fw_link_io_service_rx(fw_link_t *fwl) {
+    fw_link_ring_t *ring = &fwl->rx_ring;
+    while (fwl->readable) {
+        size_t head = ring->indices->head;
+        size_t space = ring->capacity - (head - atomic_load(ring->indices->tail));
+        if (space == 0) {
+            // the receive clip restarts us once it has made room; check once more in case it already did
+            atomic_store(fwl->rx_stall, true);
+            atomic_fence();
+            if (head - atomic_load(ring->indices->tail) == ring->capacity) {
+                return;
+            }
+            atomic_store(fwl->rx_stall, false);
+            continue;
+        }
+        struct iovec spans[2];
+        ssize_t actual = readv(fwl->fd_in, spans, fw_link_ring_spans(ring, head, space, spans));
+        if (actual == -1 && errno == EAGAIN) {
+            fwl->readable = false;
+        } else if (actual <= 0) { // 0 means EOF, <0 means error
+            abortf("Read failed: %zd when maximum was %zu", actual, space);
+        } else {
+#ifdef LINK_DEBUG
+            debug_printf(TRACE, "Read %zd bytes from file descriptor.", actual);
+#endif
+            atomic_store(ring->indices->head, head + actual);
+        }
+    }
+}
+
+static void fw_link_io_service_tx(fw_link_t *fwl) {
+    fw_link_ring_t *ring = &fwl->tx_ring;
+    for (;;) {
+        size_t tail = ring->indices->tail;
+        size_t pending = atomic_load(ring->indices->head) - tail;
+        if (pending == 0) {
+            // the transmit clip restarts us once it has staged more data; check once more in case it already did
+            atomic_store(fwl->tx_idle, true);
+            atomic_fence();
+            if (atomic_load(ring->indices->head) == tail) {
+                return;
+            }
+            continue;
+        }
+        atomic_store(fwl->tx_idle, false);
+        if (!fwl->writable) {
+            // EPOLLOUT will tell us when we can continue
+            return;
+        }
+        struct iovec spans[2];
+        ssize_t actual = writev(fwl->fd_out, spans, fw_link_ring_spans(ring, tail, pending, spans));
+        if (actual == -1 && errno == EAGAIN) {
+            fwl->writable = false;
+        } else if (actual <= 0) {
+            debug_printf(CRITICAL, "Write failed: %zd; discarding %zu bytes.", actual, pending);
+            atomic_store(ring->indices->tail, tail + pending);
+        } else {
+            assert((size_t) actual <= pending);
+#ifdef LINK_DEBUG
+            debug_printf(TRACE, "Wrote %zd bytes to file descriptor.", actual);
+#endif
+            atomic_store(ring->indices->tail, tail + actual);
+        }
+    }
+}
+
+static void *fw_link_io_loop(void *param) {
+    (void) param;
+    struct epoll_event events[FW_LINK_IO_EVENTS];
+    for (;;) {
+        int count = epoll_wait(fw_link_epoll_fd, events, FW_LINK_IO_EVENTS, -1);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("epoll_wait");
+            abortf("Fakewire link I/O thread could not wait for events.");
+        }
+        bool woken = false;
+        for (int i = 0; i < count; i++) {
+            fw_link_t *fwl = events[i].data.ptr;
+            if (fwl == NULL) {
+                uint64_t value;
+                if (read(fw_link_wake_fd, &value, sizeof(value)) < 0 && errno != EAGAIN) {
+                    perror("read");
+                    abortf("Failed to reset fakewire link I/O wakeup.");
+                }
+                woken = true;
+                continue;
+            }
+            // errors and hangups are reported by the next read or write
+            if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                fwl->readable = true;
+            }
+            if (events[i].events & (EPOLLOUT | EPOLLERR)) {
+                fwl->writable = true;
+            }
+            fw_link_io_service_rx(fwl);
+            fw_link_io_service_tx(fwl);
+        }
+        if (woken) {
+            // a clip staged output or made room for input on some link; each link only takes a few loads to check
+            for (fw_link_t *fwl = atomic_load(fw_link_io_links); fwl != NULL; fwl = fwl->io_next) {
+                fw_link_io_service_rx(fwl);
+                fw_link_io_service_tx(fwl);
+            }
+        }
+    }
+    return NULL;
+}
+
+static void fw_link_io_start(void) {
+    fw_link_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (fw_link_epoll_fd < 0) {
+        perror("epoll_create1");
+        abortf("Failed to create epoll instance for fakewire links.");
+    }
+    fw_link_wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (fw_link_wake_fd < 0) {
+        perror("eventfd");
+        abortf("Failed to create eventfd for fakewire links.");
+    }
+    struct epoll_event event = { .events = EPOLLIN, .data.ptr = NULL };
+    if (epoll_ctl(fw_link_epoll_fd, EPOLL_CTL_ADD, fw_link_wake_fd, &event) < 0) {
+        perror("epoll_ctl");
+        abortf("Failed to register eventfd for fakewire links.");
+    }
+
+    pthread_t io_thread;
+    THREAD_CHECK(pthread_create(&io_thread, NULL, fw_link_io_loop, NULL));
+    THREAD_CHECK(pthread_detach(io_thread));
+}
+
+static void fw_link_io_attach(fw_link_t *fwl) {
+    THREAD_CHECK(pthread_once(&fw_link_io_once, fw_link_io_start));
+
+    // optimistically assume readiness until the first read or write reports EAGAIN
+    fwl->readable = true;
+    fwl->writable = true;
+    THREAD_CHECK(pthread_mutex_lock(&fw_link_io_register_lock));
+    fwl->io_next = fw_link_io_links;
+    atomic_store(fw_link_io_links, fwl);
+    THREAD_CHECK(pthread_mutex_unlock(&fw_link_io_register_lock));
+
+    // edge-triggered, because the I/O thread tracks readiness itself until EAGAIN
+    struct epoll_event event = { .events = EPOLLIN | EPOLLET, .data.ptr = fwl };
+    if (fwl->fd_in == fwl->fd_out) {
+        event.events |= EPOLLOUT;
+    }
+    if (epoll_ctl(fw_link_epoll_fd, EPOLL_CTL_ADD, fwl->fd_in, &event) < 0) {
+        perror("epoll_ctl");
+        abortf("Failed to register input descriptor for fakewire link.");
+    }
+    if (fwl->fd_in != fwl->fd_out) {
+        event.events = EPOLLOUT | EPOLLET;
+        if (epoll_ctl(fw_link_epoll_fd, EPOLL_CTL_ADD, fwl->fd_out, &event) < 0) {
+            perror("epoll_ctl");
+            abortf("Failed to register output descriptor for fakewire link.");
+        }
+    }
+
+    atomic_store(fwl->io_ready, true);
+    fw_link_io_wake();
+}
+
 void fakewire_link_rx_clip(fw_link_t *fwl) {
     assert(fwl != NULL);
 
@@ -27,30 +245,34 @@ void fakewire_link_rx_clip(fw_link_t *fwl) {
     duct_txn_t txn;
     duct_send_prepare(&txn, fwl->rx_duct, REPLICA_ID);
 
-    while (fwl->fd_in != -1 && duct_send_allowed(&txn)) {
-        size_t received = 0;
-        while (received < fwl->buffer_size) {
-            // read as many bytes as possible from the input port at once
-            ssize_t actual = read(fwl->fd_in, fwl->rx_buffer + received, fwl->buffer_size - received);
-            if (actual == -1 && errno == EAGAIN) {
-                break;
-            }
-
-            if (actual <= 0) { // 0 means EOF, <0 means error
-                abortf("Read failed: %zd when maximum was %zu", actual, fwl->buffer_size);
-                return;
-            }
-            received += actual;
+    fw_link_ring_t *ring = &fwl->rx_ring;
+    bool consumed = false;
+    while (atomic_load(fwl->io_ready) && duct_send_allowed(&txn)) {
+        size_t tail = ring->indices->tail;
+        size_t available = atomic_load(ring->indices->head) - tail;
+        if (available == 0) {
+            break;
+        }
+        if (available > fwl->buffer_size) {
+            available = fwl->buffer_size;
         }
 
-        if (received == 0) {
-            break;
+        struct iovec spans[2];
+        if (fw_link_ring_spans(ring, tail, available, spans) == 1) {
+            duct_send_message(&txn, spans[0].iov_base, spans[0].iov_len, timer_epoch_ns());
+        } else {
+            duct_send_message_split(&txn, spans[0].iov_base, spans[0].iov_len,
+                                    spans[1].iov_base, spans[1].iov_len, timer_epoch_ns());
         }
-#ifdef LINK_DEBUG
-        debug_printf(TRACE, "Read %zd bytes from file descriptor.", received);
-#endif
+        atomic_store(ring->indices->tail, tail + available);
+        consumed = true;
+    }
 
-        duct_send_message(&txn, fwl->rx_buffer, received, timer_epoch_ns());
+    if (consumed) {
+        atomic_fence();
+        if (atomic_load(fwl->rx_stall) && atomic_exchange(fwl->rx_stall, false)) {
+            fw_link_io_wake();
+        }
     }
 
     duct_send_commit(&txn);
@@ -64,50 +286,183 @@ void fakewire_link_tx_clip(fw_link_t *fwl) {
     duct_txn_t txn;
     duct_receive_prepare(&txn, fwl->tx_duct, REPLICA_ID);
 
-    size_t total_blocked = 0;
-    size_t total_written = 0;
+    // the ring may be redirected during configuration, so it must not be examined until the link is ready
+    bool ready = atomic_load(fwl->io_ready);
+    fw_link_ring_t *ring = &fwl->tx_ring;
+    size_t total_dropped = 0;
+    bool staged = false;
+    const uint8_t *message;
     size_t size;
-    while (fwl->fd_out != -1 && (size = duct_receive_message(&txn, fwl->tx_buffer, NULL)) > 0) {
-        // write as many bytes as possible to the output port at once
+    while ((size = duct_receive_borrow(&txn, &message, NULL)) > 0) {
         assert(size > 0 && size <= fwl->buffer_size);
 
-        size_t remaining = size;
-        uint8_t *data = fwl->tx_buffer;
-        while (remaining > 0) {
-            ssize_t actual = write(fwl->fd_out, data, remaining);
-            if (actual == -1 && errno == EAGAIN) {
-                total_blocked += remaining;
-                goto blocked;
-            }
-            if (actual <= 0) {
-                total_blocked += remaining;
-                debug_printf(CRITICAL, "Write failed: %zd", actual);
-                goto blocked;
-            }
-            assert(0 < actual && actual <= (ssize_t) remaining);
-            remaining -= actual;
-            data += actual;
-            total_written += actual;
+        if (!ready) {
+            total_dropped += size;
+            continue;
         }
-    }
-blocked:
-    while ((size = duct_receive_message(&txn, NULL, NULL)) > 0) {
-        total_blocked += size;
+        size_t head = ring->indices->head;
+        if (ring->capacity - (head - atomic_load(ring->indices->tail)) < size) {
+            total_dropped += size;
+            continue;
+        }
+        struct iovec spans[2];
+        int num_spans = fw_link_ring_spans(ring, head, size, spans);
+        memcpy(spans[0].iov_base, message, spans[0].iov_len);
+        if (num_spans == 2) {
+            memcpy(spans[1].iov_base, message + spans[0].iov_len, spans[1].iov_len);
+        }
+        atomic_store(ring->indices->head, head + size);
+        staged = true;
     }
 
-#ifdef LINK_DEBUG
-    if (total_written > 0) {
-        debug_printf(TRACE, "Wrote %zu bytes to file descriptor.", total_written);
+    if (staged) {
+        atomic_fence();
+        if (atomic_load(fwl->tx_idle) && atomic_exchange(fwl->tx_idle, false)) {
+            fw_link_io_wake();
+        }
     }
-#endif
 
-    if (total_blocked > 0) {
-        debug_printf(WARNING, "Failed to write %zu bytes to file descriptor.", total_blocked);
+    if (total_dropped > 0) {
+        debug_printf(WARNING, "Failed to stage %zu bytes for writing to file descriptor.", total_dropped);
     }
 
     duct_receive_commit(&txn);
 }
 
+static struct fw_link_shm *fw_link_shm_map(int fd, size_t length, const char *path) {
+    struct fw_link_shm *shm = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (shm == MAP_FAILED) {
+        perror("mmap");
+        abortf("Failed to map shared memory file '%s' for fakewire link.", path);
+    }
+    return shm;
+}
+
+// a file is only usable if its producer finished publishing it and is still running; anything else was left behind
+// by an earlier run.
+static bool fw_link_shm_live(struct fw_link_shm *shm) {
+    if (atomic_load(shm->magic) != FW_LINK_SHM_MAGIC) {
+        return false;
+    }
+    return kill((pid_t) shm->producer_pid, 0) == 0 || errno == EPERM;
+}
+
+// opens (for the consumer) or creates (for the producer) the file backing a shared-memory link, and points the link's
+// rings directly into it. no I/O thread is involved: each process's clips poll the rings their peer fills.
+static void fw_link_shm_attach(fw_link_t *fwl) {
+    fw_link_options_t opts = fwl->options;
+    bool producer = (opts.flags == FW_FLAG_SHM_PROD);
+    size_t capacity = fwl->buffer_size * FW_LINK_STAGING_BUFFERS;
+    size_t length = sizeof(struct fw_link_shm) + 2 * capacity;
+
+    char path_buf[strlen(opts.path) + 10];
+    snprintf(path_buf, sizeof(path_buf), "%s.shm", opts.path);
+
+    int fd;
+    struct fw_link_shm *shm;
+    if (producer) {
+        // a file left behind by an earlier run would hand the consumer stale rings, so get rid of it before the
+        // consumer has a chance to attach to it.
+        if (unlink(path_buf) < 0 && errno != ENOENT) {
+            perror("unlink");
+            abortf("Failed to remove stale shared memory file '%s' for fakewire link.", path_buf);
+        }
+        // build the file under a temporary name, so that the consumer never sees it partially initialized
+        char temp_buf[strlen(opts.path) + 10];
+        snprintf(temp_buf, sizeof(temp_buf), "%s.shm.new", opts.path);
+        fd = open(temp_buf, O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            perror("open");
+            abortf("Failed to create shared memory file '%s' for fakewire link.", temp_buf);
+        }
+        // newly extended files read as zero, so every ring starts out empty
+        if (ftruncate(fd, length) < 0) {
+            perror("ftruncate");
+            abortf("Failed to size shared memory file '%s' for fakewire link.", temp_buf);
+        }
+        shm = fw_link_shm_map(fd, length, temp_buf);
+        close(fd);
+
+        struct timespec now;
+        if (clock_gettime(CLOCK_REALTIME, &now) < 0) {
+            perror("clock_gettime");
+            abortf("Failed to pick a generation for shared memory file '%s'.", temp_buf);
+        }
+        shm->capacity = capacity;
+        shm->producer_pid = (uint32_t) getpid();
+        shm->generation = (uint64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+        atomic_store(shm->magic, FW_LINK_SHM_MAGIC);
+        if (rename(temp_buf, path_buf) < 0) {
+            perror("rename");
+            abortf("Failed to publish shared memory file '%s' for fakewire link.", path_buf);
+        }
+        debug_printf(DEBUG, "Published shared memory file '%s' with generation %" PRIu64 ".",
+                     path_buf, shm->generation);
+    } else {
+        // if our producer has not started yet, the file at the path may still be one from an earlier run, which the
+        // producer will replace once it publishes. keep reopening the path until that happens.
+        uint64_t stale_generation = 0;
+        for (;;) {
+            while ((fd = open(path_buf, O_RDWR)) < 0 && errno == ENOENT) {
+                usleep(FW_LINK_SHM_POLL_US);
+            }
+            if (fd < 0) {
+                perror("open");
+                abortf("Failed to open shared memory file '%s' for fakewire link.", path_buf);
+            }
+            struct stat st;
+            if (fstat(fd, &st) < 0) {
+                perror("fstat");
+                abortf("Failed to inspect shared memory file '%s' for fakewire link.", path_buf);
+            }
+            // a file too short to hold the header cannot have come from a producer that finished publishing it
+            if ((size_t) st.st_size >= sizeof(struct fw_link_shm)) {
+                shm = fw_link_shm_map(fd, sizeof(struct fw_link_shm), path_buf);
+                if (fw_link_shm_live(shm)) {
+                    assertf(shm->capacity == capacity,
+                            "shared memory link '%s' has capacity %" PRIu64 " instead of %zu",
+                            path_buf, shm->capacity, capacity);
+                    munmap(shm, sizeof(struct fw_link_shm));
+                    break;
+                }
+                if (shm->generation != stale_generation) {
+                    stale_generation = shm->generation;
+                    debug_printf(WARNING, "Ignoring stale shared memory file '%s' (generation %" PRIu64 "); "
+                                 "waiting for the producer to publish.", path_buf, stale_generation);
+                }
+                munmap(shm, sizeof(struct fw_link_shm));
+            }
+            close(fd);
+            usleep(FW_LINK_SHM_POLL_US);
+        }
+        shm = fw_link_shm_map(fd, length, path_buf);
+        close(fd);
+        // the mapping stays valid without the name, and removing it means that a later run never finds it
+        if (unlink(path_buf) < 0) {
+            perror("unlink");
+            abortf("Failed to remove shared memory file '%s' for fakewire link after attaching.", path_buf);
+        }
+        debug_printf(DEBUG, "Attached to shared memory file '%s' with generation %" PRIu64 ".",
+                     path_buf, shm->generation);
+    }
+
+    uint8_t *p2c_data = &shm->data[0], *c2p_data = &shm->data[capacity];
+    fwl->rx_ring = (fw_link_ring_t) {
+        .storage = producer ? c2p_data : p2c_data,
+        .capacity = capacity,
+        .indices = producer ? &shm->c2p : &shm->p2c,
+    };
+    fwl->tx_ring = (fw_link_ring_t) {
+        .storage = producer ? p2c_data : c2p_data,
+        .capacity = capacity,
+        .indices = producer ? &shm->p2c : &shm->c2p,
+    };
+    // there is no I/O thread to wake
+    fwl->tx_idle = false;
+
+    atomic_store(fwl->io_ready, true);
+}
+
 void fakewire_link_configure(fw_link_t *fwl) {
     assert(fwl != NULL);
     fw_link_options_t opts = fwl->options;
@@ -116,6 +471,13 @@ void fakewire_link_configure(fw_link_t *fwl) {
 
     task_become_independent();
 
+    if (opts.flags == FW_FLAG_SHM_PROD || opts.flags == FW_FLAG_SHM_CONS) {
+        // waits for the producer, in the case of the consumer
+        fw_link_shm_attach(fwl);
+        task_become_dependent();
+        return;
+    }
+
     // let's open the file descriptors for our I/O backend of choice
     // we have to do this in a separate thread, because it can block in the case of pipe connections
     if (opts.flags == FW_FLAG_FIFO_CONS || opts.flags == FW_FLAG_FIFO_PROD) {
@@ -189,6 +551,7 @@ void fakewire_link_configure(fw_link_t *fwl) {
 
     task_become_dependent();
 
-    atomic_store(fwl->fd_in, fd_in);
-    atomic_store(fwl->fd_out, fd_out);
+    fwl->fd_in = fd_in;
+    fwl->fd_out = fd_out;
+    fw_link_io_attach(fwl);
 }
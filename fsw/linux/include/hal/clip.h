@@ -1,6 +1,7 @@
 #ifndef FSW_LINUX_FSW_CLIP_H
 #define FSW_LINUX_FSW_CLIP_H
 
+#include <hal/config.h>
 #include <hal/debug.h>
 #include <hal/thread.h>
 
@@ -12,6 +13,8 @@ typedef struct {
 } clip_t;
 
 void clip_loop(clip_t *clip);
+// writes the execution-time profile of every schedule entry to a text file; only called by the scheduler
+void clip_profile_export(const char *path);
 
 macro_define(CLIP_PROTO, c_ident) {
     extern clip_t c_ident;
@@ -46,4 +49,38 @@ static inline void clip_assert(void) {
             "running in task %s, which is not a clip", task_get_name(task_get_current()));
 }
 
+enum clip_access {
+    CLIP_ACCESS_EXCLUSIVE = 0, // conflicts with every other access to the same resource
+    CLIP_ACCESS_SEND,          // conflicts only with CLIP_ACCESS_RECEIVE or CLIP_ACCESS_EXCLUSIVE
+    CLIP_ACCESS_RECEIVE,       // conflicts only with CLIP_ACCESS_SEND or CLIP_ACCESS_EXCLUSIVE
+    CLIP_ACCESS_BARRIER,       // resource is ignored; the clip may never run alongside any other task
+};
+
+#if ( LINUX_PARALLEL_CLIPS == 1 )
+
+// true while the scheduler is still observing which resources each clip touches
+extern bool clip_learning;
+
+void clip_record_access(const void *resource, enum clip_access access);
+// true if the accesses recorded for the two tasks forbid running them in the same wave
+bool clip_tasks_conflict(thread_t a, thread_t b);
+
+// declares that the current task touches a shared resource, so that the scheduler will not run it alongside any
+// other clip that touches the same resource in a conflicting way. must be called every epoch that the resource is
+// used, and before the resource is used.
+static inline void clip_note_access(const void *resource, enum clip_access access) {
+    if (atomic_load_relaxed(clip_learning)) {
+        clip_record_access(resource, access);
+    }
+}
+
+#else /* ( LINUX_PARALLEL_CLIPS == 0 ) */
+
+static inline void clip_note_access(const void *resource, enum clip_access access) {
+    (void) resource;
+    (void) access;
+}
+
+#endif
+
 #endif /* FSW_LINUX_FSW_CLIP_H */
@@ -0,0 +1,19 @@
+#ifndef FSW_LINUX_HAL_CONFIG_H
+#define FSW_LINUX_HAL_CONFIG_H
+
+/* set to 1 to run on a virtual clock that advances by the scheduled partition durations, so that epochs run
+ * back-to-back as fast as the host allows; set to 0 to pace the schedule against the host's monotonic clock */
+#define LINUX_VIRTUAL_TIME                              0
+
+/* set to 1 to run clips that share no ducts or other tracked state concurrently on separate host cores, in waves
+ * planned by observing the first LINUX_PARALLEL_LEARNING_EPOCHS epochs sequentially; set to 0 to always run the
+ * schedule one task at a time */
+#define LINUX_PARALLEL_CLIPS                            0
+#define LINUX_PARALLEL_LEARNING_EPOCHS                  16
+
+/* the scheduler rewrites LINUX_CLIP_PROFILE_PATH with the execution-time profile of every schedule entry once every
+ * LINUX_CLIP_PROFILE_EPOCHS epochs; set to 0 to never write the profile */
+#define LINUX_CLIP_PROFILE_EPOCHS                       1000
+#define LINUX_CLIP_PROFILE_PATH                         "clip-profile.txt"
+
+#endif /* FSW_LINUX_HAL_CONFIG_H */
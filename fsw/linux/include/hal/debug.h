@@ -2,19 +2,45 @@
 #define FSW_LINUX_FSW_DEBUG_H
 
 #include <assert.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <hal/loglevel.h>
 #include <flight/clock.h>
 
+#ifndef __PYTHON_PREPROCESS__
+
+#warning Need python preprocessor phase to deal with debugf substitution
+extern void debugf_core(loglevel_t level, const char *stable_id, const char *format, ...);
+
+#endif
+
 #define TIMEFMT "%3.9f"
 #define TIMEARG(x) ((x) / 1000000000.0)
 
 /* note: should not use TIMEARG like this in general; the argument must not be a function call on Vivid */
+// the printf call is never evaluated. it is only there so that -Wformat still checks the arguments against the format
+// string, since debugf_core encodes them by the types the format string implies.
+#define debugf_check_format(fmt, ...) if (0) { printf(fmt, ## __VA_ARGS__); }
 #define debugf(level, fmt, ...)                                                                                       \
-        ({ printf("[" TIMEFMT "] " fmt "\n", TIMEARG(clock_timestamp_fast()), ## __VA_ARGS__); fflush(stdout); })
-#define debugf_stable(level, stable_id, fmt, ...) debugf(level, fmt, ## __VA_ARGS)
+        ({ debugf_check_format(fmt, ## __VA_ARGS__) debugf_core(level, "", fmt, ## __VA_ARGS__); })
+#define debugf_stable(level, stable_id, fmt, ...)                                                                     \
+        ({ debugf_check_format(fmt, ## __VA_ARGS__) debugf_core(level, #stable_id, fmt, ## __VA_ARGS__); })
+
+// invocations to debugf_internal are generated by the debugf_core macro in the python preprocessor. messages are
+// recorded in binary form into a per-thread ring buffer, and rendered to stdout by a separate drain thread, so that
+// the caller never blocks on terminal or pipe I/O. CRITICAL messages are rendered synchronously.
+extern void debugf_internal(const void **data_sequences, const size_t *data_sizes, size_t data_num);
+
+struct debugf_metadata {
+    uint32_t loglevel;
+    const char *stable_id;
+    const char *format;
+    const char *filename;
+    uint32_t line_number;
+} __attribute__((packed));
 
 // generic but messier implementation
 #define assertf(x, ...) assert((x) || (debugf(CRITICAL, "[assert] " __VA_ARGS__), 0))
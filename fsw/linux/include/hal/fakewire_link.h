@@ -10,18 +10,46 @@
 #define FAKEWIRE_LINK_RECEIVE_REPLICAS  1
 #define FAKEWIRE_LINK_TRANSMIT_REPLICAS 1
 
+enum {
+    // bytes staged between a link's clips and the I/O thread in each direction, in units of the link's buffer size
+    FW_LINK_STAGING_BUFFERS = 8,
+};
+
+// free-running positions of a single-producer single-consumer byte ring. these may live in memory shared with
+// another process, so each is kept on its own cache line.
+typedef struct {
+    size_t head __attribute__((__aligned__(64))); // only advanced by the producer
+    size_t tail __attribute__((__aligned__(64))); // only advanced by the consumer
+} fw_link_ring_indices_t;
+
 typedef struct {
+    uint8_t                *storage;
+    size_t                  capacity;
+    fw_link_ring_indices_t *indices;
+} fw_link_ring_t;
+
+typedef struct fw_link_st {
     int fd_in;
     int fd_out;
+    bool io_ready; // set once the rings are being served, either by the I/O thread or by a shared-memory peer
 
     size_t buffer_size;
-    uint8_t *rx_buffer;
-    uint8_t *tx_buffer;
+
+    // for shared-memory links, these are redirected into the mapping and the peer process takes the I/O thread's role
+    fw_link_ring_t rx_ring;  // filled by the I/O thread, drained by the receive clip
+    fw_link_ring_t tx_ring;  // filled by the transmit clip, drained by the I/O thread
+    fw_link_ring_indices_t rx_indices;
+    fw_link_ring_indices_t tx_indices;
+    bool           rx_stall; // set by the I/O thread when it stops reading because rx_ring is full
+    bool           tx_idle;  // set by the I/O thread when it stops writing because tx_ring is empty
+    bool           readable; // owned by the I/O thread: the input descriptor may have more data to read
+    bool           writable; // owned by the I/O thread: the output descriptor may accept more data
 
     duct_t *rx_duct;
     duct_t *tx_duct;
 
     fw_link_options_t options;
+    struct fw_link_st *io_next; // next link served by the I/O thread
 } fw_link_t;
 
 void fakewire_link_rx_clip(fw_link_t *fwl);
@@ -34,17 +62,33 @@ macro_define(FAKEWIRE_LINK_REGISTER,
     TASK_REGISTER(symbol_join(l_ident, cfg), fakewire_link_configure, &l_ident, NOT_RESTARTABLE);
     CLIP_REGISTER(symbol_join(l_ident, rxc), fakewire_link_rx_clip, &l_ident);
     CLIP_REGISTER(symbol_join(l_ident, txc), fakewire_link_tx_clip, &l_ident);
-    uint8_t symbol_join(l_ident, rx_buffer)[l_buf_size];
-    uint8_t symbol_join(l_ident, tx_buffer)[l_buf_size];
+    uint8_t symbol_join(l_ident, rx_staging)[(l_buf_size) * FW_LINK_STAGING_BUFFERS];
+    uint8_t symbol_join(l_ident, tx_staging)[(l_buf_size) * FW_LINK_STAGING_BUFFERS];
     fw_link_t l_ident = {
         .fd_in = -1,
         .fd_out = -1,
+        .io_ready = false,
         .buffer_size = (l_buf_size),
-        .rx_buffer = symbol_join(l_ident, rx_buffer),
-        .tx_buffer = symbol_join(l_ident, tx_buffer),
+        .rx_ring = {
+            .storage = symbol_join(l_ident, rx_staging),
+            .capacity = (l_buf_size) * FW_LINK_STAGING_BUFFERS,
+            .indices = &(l_ident).rx_indices,
+        },
+        .rx_indices = { .head = 0, .tail = 0 },
+        .tx_ring = {
+            .storage = symbol_join(l_ident, tx_staging),
+            .capacity = (l_buf_size) * FW_LINK_STAGING_BUFFERS,
+            .indices = &(l_ident).tx_indices,
+        },
+        .tx_indices = { .head = 0, .tail = 0 },
+        .rx_stall = false,
+        .tx_idle = true,
+        .readable = false,
+        .writable = false,
         .rx_duct = &(l_rx),
         .tx_duct = &(l_tx),
         .options = (l_options),
+        .io_next = NULL,
     }
 }
 
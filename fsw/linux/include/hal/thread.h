@@ -4,6 +4,7 @@
 #include <assert.h>
 #include <errno.h>
 #include <pthread.h>
+#include <semaphore.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -12,6 +13,8 @@
 #include <unistd.h>
 
 #include <hal/atomic.h>
+#include <hal/config.h>
+#include <hal/profile.h>
 #include <hal/timer.h>
 #include <hal/preprocessor.h>
 
@@ -26,7 +29,16 @@ typedef struct thread_st {
     void *start_parameter;
     pthread_t thread;
     bool scheduler_independent; // used during IO waits
-    pthread_cond_t sched_cond;
+    sem_t sched_wake; // posted to hand the schedule directly to this thread
+    uint32_t sched_position; // the schedule entry this thread was most recently woken for
+    bool sched_holding; // true from the time this thread is woken until it releases its slot
+#if ( LINUX_PARALLEL_CLIPS == 1 )
+    // resources recorded by clip_note_access while the scheduler was learning
+    struct clip_access_record *accesses;
+    size_t num_accesses;
+    size_t max_accesses;
+    bool access_barrier;
+#endif
 } __attribute__((__aligned__(16))) *thread_t; // alignment must be specified for x86_64 compatibility
 
 thread_t task_get_current(void);
@@ -104,6 +116,8 @@ typedef struct {
 
 extern const schedule_entry_t task_scheduling_order[];
 extern const uint32_t         task_scheduling_order_length;
+// execution times of the clips in each entry of task_scheduling_order
+extern profile_t              task_scheduling_profiles[];
 
 macro_define(TASK_SCHEDULE, t_ident, t_micros) {
     { .task = &(t_ident), .nanos = (t_micros) * 1000 },
@@ -114,6 +128,7 @@ macro_block_define(SCHEDULE_PARTITION_ORDER, body) {
         body
     };
     const uint32_t task_scheduling_order_length = sizeof(task_scheduling_order) / sizeof(task_scheduling_order[0]);
+    profile_t task_scheduling_profiles[sizeof(task_scheduling_order) / sizeof(task_scheduling_order[0])];
 }
 
 #endif /* FSW_LINUX_HAL_THREAD_H */
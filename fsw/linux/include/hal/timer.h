@@ -3,13 +3,36 @@
 
 #include <time.h>
 
+#include <hal/atomic.h>
+#include <hal/config.h>
 #include <hal/time.h>
 
-static inline local_time_t timer_now_ns(void) {
+// reads the host's monotonic clock, regardless of whether virtual time is enabled
+static inline local_time_t timer_host_now_ns(void) {
     struct timespec ct;
     int time_ok = clock_gettime(CLOCK_MONOTONIC, &ct);
     assert(time_ok == 0);
     return CLOCK_NS_PER_SEC * (int64_t) ct.tv_sec + (int64_t) ct.tv_nsec;
 }
 
+#if ( LINUX_VIRTUAL_TIME == 1 )
+
+// only advanced by whichever thread currently holds the schedule
+extern local_time_t timer_virtual_ns;
+// the virtual time at which the current thread's slot in the schedule began, or 0 if it is not holding a slot
+extern __thread local_time_t timer_virtual_slot_ns;
+
+static inline local_time_t timer_now_ns(void) {
+    local_time_t slot_ns = timer_virtual_slot_ns;
+    return slot_ns != 0 ? slot_ns : atomic_load_relaxed(timer_virtual_ns);
+}
+
+#else /* ( LINUX_VIRTUAL_TIME == 0 ) */
+
+static inline local_time_t timer_now_ns(void) {
+    return timer_host_now_ns();
+}
+
+#endif
+
 #endif /* FSW_LINUX_HAL_TIMER_H */
@@ -1,5 +1,6 @@
 #include <inttypes.h>
 
+#include <hal/clip.h>
 #include <hal/debug.h>
 #include <hal/thread.h>
 #include <hal/timer.h>
@@ -13,23 +14,113 @@ static pthread_key_t task_current_key;
 extern struct thread_st tasktable_start[];
 extern struct thread_st tasktable_end[];
 
-static mutex_t        scheduling_lock;
-static thread_t       scheduled_task;
+// the schedule is passed directly from one wave of tasks to the next in task_scheduling_order, like a baton. unless
+// LINUX_PARALLEL_CLIPS is enabled, every wave is exactly one schedule entry. only the holder of the baton (either the
+// scheduler itself, or the last task in the current wave to release its slot) may modify schedule_position.
+static sem_t          scheduler_wake;
+static uint32_t       schedule_position; // first entry of the current wave
+static uint32_t       schedule_pending;  // tasks in the current wave that have not yet released their slots
 static uint32_t       schedule_index;
 
 local_time_t   schedule_epoch_start = 0;
 
+#if ( LINUX_PARALLEL_CLIPS == 1 )
+// for each entry that begins a wave, the entry just past the end of that wave; NULL while still learning.
+static uint32_t *schedule_wave_end = NULL;
+#endif
+
+#if ( LINUX_VIRTUAL_TIME == 1 )
+local_time_t timer_virtual_ns = 0;
+__thread local_time_t timer_virtual_slot_ns = 0;
+// offset of each schedule entry from the start of the epoch, followed by the total length of the epoch
+static local_time_t *schedule_offsets = NULL;
+#endif
+
+// on the virtual clock, time passes as the schedule reaches each entry, as if every earlier entry used its full slot.
+static inline void schedule_advance_clock(uint32_t position) {
+#if ( LINUX_VIRTUAL_TIME == 1 )
+    assert(position <= task_scheduling_order_length);
+    atomic_store_relaxed(timer_virtual_ns, schedule_epoch_start + schedule_offsets[position]);
+#else
+    (void) position;
+#endif
+}
+
+static inline uint32_t schedule_wave_end_of(uint32_t position) {
+#if ( LINUX_PARALLEL_CLIPS == 1 )
+    if (schedule_wave_end != NULL) {
+        return schedule_wave_end[position];
+    }
+#endif
+    return position + 1;
+}
+
 thread_t task_get_current(void) {
     thread_t thread = (thread_t) pthread_getspecific(task_current_key);
     assert(thread != NULL && thread->thread == pthread_self());
     return thread;
 }
 
-static void task_wait_scheduled(void) {
-    thread_t task = task_get_current();
-    // TODO: avoid the thundering herd problem
-    while (scheduled_task != task) {
-        THREAD_CHECK(pthread_cond_wait(&task->sched_cond, &scheduling_lock));
+static void semaphore_wait(sem_t *sem) {
+    while (sem_wait(sem) < 0) {
+        if (errno != EINTR) {
+            abortf("thread error: %d in sem_wait", errno);
+        }
+    }
+}
+
+static void task_wait_scheduled(thread_t task) {
+    assert(task != NULL);
+    semaphore_wait(&task->sched_wake);
+    assert(atomic_load(task->sched_holding));
+#if ( LINUX_VIRTUAL_TIME == 1 )
+    // within a wave, each task still sees the time at which the sequential schedule would have reached it.
+    timer_virtual_slot_ns = schedule_epoch_start + schedule_offsets[task->sched_position];
+#endif
+}
+
+// must only be called by the current holder of the schedule. wakes every dependent task in the next wave at or after
+// the specified position, or the scheduler itself if the epoch is over.
+static void task_handoff(uint32_t position) {
+    while (position < task_scheduling_order_length) {
+        uint32_t end = schedule_wave_end_of(position);
+        assert(end > position && end <= task_scheduling_order_length);
+        schedule_position = position;
+        schedule_advance_clock(position);
+        // hold an extra count while waking the wave, so that no woken task can pass the baton on prematurely.
+        atomic_store(schedule_pending, 1);
+        for (uint32_t p = position; p < end; p++) {
+            thread_t next = task_scheduling_order[p].task;
+            assert(next != NULL);
+            if (!atomic_load(next->scheduler_independent)) {
+#ifdef SCHED_DEBUG
+                debugf(TRACE, "Scheduling: %s", next->name);
+#endif
+                atomic_fetch_add(schedule_pending, 1);
+                next->sched_position = p;
+                atomic_store(next->sched_holding, true);
+                THREAD_CHECK(sem_post(&next->sched_wake));
+            }
+        }
+        if (atomic_fetch_sub(schedule_pending, 1) != 1) {
+            return;
+        }
+        // every task in the wave was independent, or has already released its slot, so we still hold the baton.
+        position = end;
+    }
+    schedule_advance_clock(task_scheduling_order_length);
+    THREAD_CHECK(sem_post(&scheduler_wake));
+}
+
+// gives up the current task's slot in the schedule; the last task in the wave to do so passes on the baton.
+static void task_release(thread_t task) {
+    assert(atomic_load(task->sched_holding));
+    atomic_store(task->sched_holding, false);
+#if ( LINUX_VIRTUAL_TIME == 1 )
+    timer_virtual_slot_ns = 0;
+#endif
+    if (atomic_fetch_sub(schedule_pending, 1) == 1) {
+        task_handoff(schedule_wave_end_of(schedule_position));
     }
 }
 
@@ -41,9 +132,7 @@ static void *thread_entry_wrapper(void *param) {
     THREAD_CHECK(pthread_setspecific(task_current_key, thread));
 
     // yield before entering start routine, so that we only "go" when we're scheduled to
-    mutex_lock(&scheduling_lock);
-    task_wait_scheduled();
-    mutex_unlock(&scheduling_lock);
+    task_wait_scheduled(thread);
 
     assertf(thread->start_routine != NULL, "no start routine for thread %s", thread->name);
     thread->start_routine(thread->start_parameter);
@@ -57,11 +146,7 @@ static void *thread_entry_wrapper(void *param) {
 static void start_predef_threads(void) {
     assert(!initialized);
 
-    mutex_init(&scheduling_lock);
-    pthread_condattr_t attr;
-    THREAD_CHECK(pthread_condattr_init(&attr));
-    THREAD_CHECK(pthread_condattr_setclock(&attr, CLOCK_MONOTONIC));
-    scheduled_task = NULL;
+    THREAD_CHECK(sem_init(&scheduler_wake, 0, 0));
 
     initialized = true;
 
@@ -70,22 +155,17 @@ static void start_predef_threads(void) {
 
     debugf(DEBUG, "Starting predefined threads...");
     for (thread_t task = tasktable_start; task < tasktable_end; task++) {
-        THREAD_CHECK(pthread_cond_init(&task->sched_cond, &attr));
+        THREAD_CHECK(sem_init(&task->sched_wake, 0, 0));
         THREAD_CHECK(pthread_create(&task->thread, NULL, thread_entry_wrapper, task));
     }
     debugf(DEBUG, "Predefined threads started!");
-    THREAD_CHECK(pthread_condattr_destroy(&attr));
 }
 
 void task_yield(void) {
-    mutex_lock(&scheduling_lock);
     thread_t task = task_get_current();
     assert(task->scheduler_independent == false);
-    assert(scheduled_task == task);
-    scheduled_task = NULL;
-    pthread_cond_broadcast(&task->sched_cond);
-    task_wait_scheduled();
-    mutex_unlock(&scheduling_lock);
+    task_release(task);
+    task_wait_scheduled(task);
 }
 
 uint32_t task_tick_index(void) {
@@ -94,74 +174,152 @@ uint32_t task_tick_index(void) {
 
 void task_become_independent(void) {
     thread_t task = task_get_current();
-    mutex_lock(&scheduling_lock);
     assert(task->scheduler_independent == false);
-    assert(scheduled_task == task);
-    scheduled_task = NULL;
-    task->scheduler_independent = true;
-    pthread_cond_broadcast(&task->sched_cond);
-    mutex_unlock(&scheduling_lock);
+    atomic_store(task->scheduler_independent, true);
+    task_release(task);
 }
 
 void task_become_dependent(void) {
     thread_t task = task_get_current();
-    mutex_lock(&scheduling_lock);
     assert(task->scheduler_independent == true);
-    task->scheduler_independent = false;
-    task_wait_scheduled();
-    mutex_unlock(&scheduling_lock);
+    // once this is visible, the next holder of the schedule will wake us when it reaches our position.
+    atomic_store(task->scheduler_independent, false);
+    task_wait_scheduled(task);
 }
 
-static void task_schedule(schedule_entry_t entry) {
-    // debugf(TRACE, "Scheduling: %s", entry.task->name);
-    assert(entry.task != NULL);
-
-    struct timespec deadline_ts;
+// for diagnostics only: returns some task currently holding a slot in the schedule, if any.
+static thread_t schedule_find_holder(void) {
+    uint32_t position = atomic_load_relaxed(schedule_position);
+    for (uint32_t p = position; p < schedule_wave_end_of(position); p++) {
+        thread_t task = task_scheduling_order[p].task;
+        if (atomic_load(task->sched_holding)) {
+            return task;
+        }
+    }
+    return NULL;
+}
 
-    THREAD_CHECK(clock_gettime(CLOCK_MONOTONIC, &deadline_ts));
-    deadline_ts.tv_sec += 1;
+static void run_epoch(void) {
+    task_handoff(0);
 
-    mutex_lock(&scheduling_lock);
-    assert(scheduled_task == NULL);
-    if (entry.task->scheduler_independent) {
-        mutex_unlock(&scheduling_lock);
-        return;
+    thread_t reported = NULL;
+    for (;;) {
+        struct timespec deadline_ts;
+        THREAD_CHECK(clock_gettime(CLOCK_REALTIME, &deadline_ts));
+        deadline_ts.tv_sec += 1;
+
+        if (sem_timedwait(&scheduler_wake, &deadline_ts) == 0) {
+            break;
+        } else if (errno == ETIMEDOUT) {
+            // went an entire second without finishing the epoch! we assume this indicates a malfunction, rather
+            // than a delay, and blame whichever task is currently holding the schedule.
+            thread_t current = schedule_find_holder();
+            if (current != NULL && current != reported) {
+                debugf(WARNING, "task %s overran scheduling period", current->name);
+                reported = current;
+            }
+        } else if (errno != EINTR) {
+            abortf("thread error: %d in run_epoch semaphore loop", errno);
+        }
     }
-    scheduled_task = entry.task;
-    pthread_cond_broadcast(&scheduled_task->sched_cond);
-    while (scheduled_task != NULL) {
-        int retcode = pthread_cond_timedwait(&scheduled_task->sched_cond, &scheduling_lock, &deadline_ts);
-        if (retcode == ETIMEDOUT) {
-            // went an entire second without yielding! we assume this indicates a malfunction, rather than a delay
-            debugf(WARNING, "task %s overran scheduling period", entry.task->name);
-            THREAD_CHECK(pthread_cond_wait(&scheduled_task->sched_cond, &scheduling_lock));
-        } else if (retcode != 0 && retcode != EINTR) {
-            abortf("thread error: %d in task_schedule condition loop", retcode);
+    assert(atomic_load(schedule_pending) == 0);
+}
+
+#if ( LINUX_PARALLEL_CLIPS == 1 )
+static bool schedule_is_clip(thread_t task) {
+    return task->start_routine == PP_ERASE_TYPE(clip_loop, (clip_t *) NULL);
+}
+
+// groups consecutive schedule entries into waves of clips that can run concurrently without any observable
+// difference from running them in order. must only be called by the scheduler between epochs.
+static void schedule_plan_waves(void) {
+    assert(schedule_wave_end == NULL);
+    uint32_t *wave_end = malloc(sizeof(uint32_t) * task_scheduling_order_length);
+    assert(wave_end != NULL);
+
+    uint32_t waves = 0;
+    for (uint32_t start = 0; start < task_scheduling_order_length; start = wave_end[start]) {
+        uint32_t end = start + 1;
+        if (schedule_is_clip(task_scheduling_order[start].task)) {
+            for (; end < task_scheduling_order_length; end++) {
+                thread_t candidate = task_scheduling_order[end].task;
+                if (!schedule_is_clip(candidate)) {
+                    break;
+                }
+                bool conflict = false;
+                for (uint32_t p = start; p < end && !conflict; p++) {
+                    conflict = clip_tasks_conflict(task_scheduling_order[p].task, candidate);
+                }
+                if (conflict) {
+                    break;
+                }
+            }
+        }
+        for (uint32_t p = start; p < end; p++) {
+            wave_end[p] = end;
         }
+        waves++;
     }
-    mutex_unlock(&scheduling_lock);
 
-    // uint64_t total_time = timer_now_ns() - start_ns;
-    // if (total_time > entry.nanos) {
-    //     debugf(TRACE, "task %s consumed %" PRIu64 " > %u", entry.task->name, total_time, entry.nanos);
-    // }
+    atomic_store_relaxed(clip_learning, false);
+    schedule_wave_end = wave_end;
+    debugf(INFO, "Planned %u waves for %u schedule entries.", waves, task_scheduling_order_length);
 }
+#endif
 
-void enter_scheduler(void) {
-    start_predef_threads();
+static void schedule_end_epoch(void) {
+    schedule_index++;
+#if ( LINUX_CLIP_PROFILE_EPOCHS > 0 )
+    if (schedule_index % LINUX_CLIP_PROFILE_EPOCHS == 0) {
+        clip_profile_export(LINUX_CLIP_PROFILE_PATH);
+    }
+#endif
+#if ( LINUX_PARALLEL_CLIPS == 1 )
+    if (schedule_index == LINUX_PARALLEL_LEARNING_EPOCHS) {
+        schedule_plan_waves();
+    }
+#endif
+}
 
+void enter_scheduler(void) {
     uint64_t total = 0;
+#if ( LINUX_VIRTUAL_TIME == 1 )
+    schedule_offsets = malloc(sizeof(local_time_t) * (task_scheduling_order_length + 1));
+    assert(schedule_offsets != NULL);
+    for (uint32_t i = 0; i < task_scheduling_order_length; i++) {
+        schedule_offsets[i] = total;
+        total += task_scheduling_order[i].nanos;
+    }
+    schedule_offsets[task_scheduling_order_length] = total;
+    // start from the host's clock, so that timestamps look the same as they would otherwise
+    atomic_store_relaxed(timer_virtual_ns, timer_host_now_ns());
+    debugf(INFO, "Running on virtual clock; each epoch advances time by %" PRIu64 " ns.", total);
+#else
     for (uint32_t i = 0; i < task_scheduling_order_length; i++) {
         total += task_scheduling_order[i].nanos;
     }
+#endif
+
+#if ( LINUX_PARALLEL_CLIPS == 1 )
+    // run sequentially at first, so that we can observe which resources each clip needs.
+    atomic_store_relaxed(clip_learning, true);
+#endif
+
+    start_predef_threads();
 
+#if ( LINUX_VIRTUAL_TIME == 1 )
+    for (;;) {
+        // no pacing is needed: by the end of each epoch, the virtual clock has advanced by exactly one epoch.
+        schedule_epoch_start = timer_now_ns();
+        run_epoch();
+        schedule_end_epoch();
+    }
+#else
     uint64_t last = timer_now_ns();
     for (;;) {
         // debugf(TRACE, "beginning cycle of schedule");
         schedule_epoch_start = timer_now_ns();
-        for (uint32_t i = 0; i < task_scheduling_order_length; i++) {
-            task_schedule(task_scheduling_order[i]);
-        }
+        run_epoch();
         uint64_t here = timer_now_ns();
         if (here - last > total) {
             debugf(TRACE, "Epoch too long:   %" PRIu64 " > %" PRIu64, here - last, total);
@@ -175,6 +333,7 @@ void enter_scheduler(void) {
             }
         }
         last = timer_now_ns();
-        schedule_index++;
+        schedule_end_epoch();
     }
+#endif
 }
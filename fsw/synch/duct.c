@@ -9,6 +9,40 @@
 
 //#define DUCT_DEBUG
 
+#if ( CONFIG_SYNCH_DUCT_DIGESTS == 1 )
+// word-at-a-time FNV-1a variant. every step is invertible, so any corruption confined to a single word is always
+// detected; this is not intended to be a cryptographic hash.
+static uint32_t duct_digest(const uint8_t *body, size_t size) {
+    uint32_t hash = 2166136261u ^ (uint32_t) size;
+    size_t i = 0;
+    for (; i + sizeof(uint32_t) <= size; i += sizeof(uint32_t)) {
+        hash = (hash ^ *(const uint32_t *) &body[i]) * 16777619u;
+    }
+    if (i < size) {
+        uint32_t tail = 0;
+        memcpy(&tail, &body[i], size - i);
+        hash = (hash ^ tail) * 16777619u;
+    }
+    return hash;
+}
+#endif
+
+// compares word-at-a-time, which is safe because flow slots (and therefore message bodies) are aligned.
+static bool duct_body_equal(const uint8_t *a, const uint8_t *b, size_t size) {
+    size_t i = 0;
+    for (; i + sizeof(uint32_t) <= size; i += sizeof(uint32_t)) {
+        if (*(const uint32_t *) &a[i] != *(const uint32_t *) &b[i]) {
+            return false;
+        }
+    }
+    for (; i < size; i++) {
+        if (a[i] != b[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
 void duct_send_prepare(duct_txn_t *txn, duct_t *duct, uint8_t sender_id) {
     assert(txn != NULL && duct != NULL);
     assertf(sender_id < duct->sender_replicas,
@@ -18,6 +52,9 @@ void duct_send_prepare(duct_txn_t *txn, duct_t *duct, uint8_t sender_id) {
     debugf(TRACE, "duct %s[sender=%u]: prepare send", duct->label, sender_id);
 #endif
 
+    // each sender and receiver only touches its own flows, so replicas on the same side of a duct never conflict.
+    clip_note_access(duct, CLIP_ACCESS_SEND);
+
     txn->mode = DUCT_TXN_SEND;
     txn->duct = duct;
     txn->replica_id = sender_id;
@@ -50,11 +87,19 @@ bool duct_send_allowed(duct_txn_t *txn) {
 
 // asserts if we've used up our max flow in this transaction already
 void duct_send_message(duct_txn_t *txn, const void *message, size_t size, local_time_t timestamp) {
+    assert(message != NULL);
+    duct_send_message_split(txn, message, size, NULL, 0, timestamp);
+}
+
+// asserts if we've used up our max flow in this transaction already
+void duct_send_message_split(duct_txn_t *txn, const void *first, size_t first_size,
+                             const void *second, size_t second_size, local_time_t timestamp) {
     assert(txn != NULL && txn->duct != NULL);
     assert(txn->mode == DUCT_TXN_SEND);
     assert(txn->replica_id < txn->duct->sender_replicas);
     assert(txn->flow_current < txn->duct->max_flow);
-    assert(message != NULL);
+    assert(first != NULL && (second != NULL || second_size == 0));
+    size_t size = first_size + second_size;
     assertf(size >= 1 && size <= txn->duct->message_size,
             "invalid message size; %zu not in [1, %zu].", size, txn->duct->message_size);
 
@@ -62,9 +107,16 @@ void duct_send_message(duct_txn_t *txn, const void *message, size_t size, local_
     duct_message_t *entry = duct_lookup_message(txn->duct, txn->replica_id, txn->flow_current);
     entry->size = size;
     entry->timestamp = timestamp;
-    memcpy(entry->body, message, size);
+    memcpy(entry->body, first, first_size);
+    if (second_size > 0) {
+        memcpy(entry->body + first_size, second, second_size);
+    }
     // NOTE: this memset is too slow to be allowable!
     // memset(entry->body + size, 0, duct->message_size - size);
+#if ( CONFIG_SYNCH_DUCT_DIGESTS == 1 )
+    // compute the digest from the copy in the transit queue, so that it matches what the receivers will see.
+    entry->digest = duct_digest(entry->body, size);
+#endif
 
     txn->flow_current += 1;
 }
@@ -107,6 +159,8 @@ void duct_receive_prepare(duct_txn_t *txn, duct_t *duct, uint8_t receiver_id) {
     debugf(TRACE, "duct %s[receiver=%u]: prepare receive", duct->label, receiver_id);
 #endif
 
+    clip_note_access(duct, CLIP_ACCESS_RECEIVE);
+
     txn->mode = DUCT_TXN_RECV;
     txn->duct = duct;
     txn->replica_id = receiver_id;
@@ -146,8 +200,8 @@ static duct_message_t *duct_check_message(duct_t *duct, uint8_t sender_id, uint8
     return candidate;
 }
 
-// returns size > 0 if a message was successfully received. if size = 0, then we're done with this transaction.
-size_t duct_receive_message(duct_txn_t *txn, void *message_out, local_time_t *timestamp_out) {
+// returns the voted message and advances the flow, or NULL if there are no more messages to receive.
+static duct_message_t *duct_vote_message(duct_txn_t *txn) {
     assert(txn != NULL && txn->duct != NULL);
     assert(txn->mode == DUCT_TXN_RECV);
     assert(txn->replica_id < txn->duct->receiver_replicas);
@@ -155,7 +209,7 @@ size_t duct_receive_message(duct_txn_t *txn, void *message_out, local_time_t *ti
 
     if (txn->flow_current == txn->duct->max_flow) {
         /* indicate that we've read the maximum number of messages */
-        return 0;
+        return NULL;
     }
 
     // note: this code is written assuming that the receiver is running in a clip.
@@ -175,6 +229,10 @@ size_t duct_receive_message(duct_txn_t *txn, void *message_out, local_time_t *ti
         valid_messages++;
         duct_flow_index votes = 1;
         duct_flow_index total_valid_messages = valid_messages;
+#if ( CONFIG_SYNCH_DUCT_DIGESTS == 1 )
+        // set once some other replica's body has been found to match this candidate's byte-for-byte
+        bool body_confirmed = false;
+#endif
         for (uint8_t compare_id = candidate_id + 1; compare_id < txn->duct->sender_replicas; compare_id++) {
             duct_message_t *compare = duct_check_message(txn->duct, compare_id, txn->replica_id, txn->flow_current);
             if (compare == NULL) {
@@ -192,9 +250,19 @@ size_t duct_receive_message(duct_txn_t *txn, void *message_out, local_time_t *ti
                        candidate->size, compare->size, TIMEARG(candidate->timestamp), TIMEARG(compare->timestamp));
                 continue;
             }
-            if (memcmp(candidate->body, compare->body, compare->size) != 0) {
+#if ( CONFIG_SYNCH_DUCT_DIGESTS == 1 )
+            // the digests sit in the same transit slots as the bodies, so they can be corrupted too. a digest mismatch
+            // only means that the bodies are worth comparing in full.
+            bool digest_match = (compare->digest == candidate->digest);
+            if (!digest_match && !duct_body_equal(candidate->body, compare->body, compare->size)) {
+                debugf(TRACE, "duct %s[receiver=%u]: candidate %u -> compare %u: digest and data mismatch "
+                       "(%08x ? %08x, len %zu); skipping.", txn->duct->label, txn->replica_id, candidate_id, compare_id,
+                       candidate->digest, compare->digest, compare->size);
+#else
+            if (!duct_body_equal(candidate->body, compare->body, compare->size)) {
                 debugf(TRACE, "duct %s[receiver=%u]: candidate %u -> compare %u: data mismatch (len %zu); skipping.",
                        txn->duct->label, txn->replica_id, candidate_id, compare_id, compare->size);
+#endif
                 size_t i = 0;
                 while (i + 16 <= compare->size) {
                     uint32_t *ca_data = (uint32_t *) &candidate->body[i];
@@ -220,6 +288,11 @@ size_t duct_receive_message(duct_txn_t *txn, void *message_out, local_time_t *ti
                 }
                 continue;
             }
+#if ( CONFIG_SYNCH_DUCT_DIGESTS == 1 )
+            if (!digest_match) {
+                body_confirmed = true;
+            }
+#endif
             votes++;
 #ifdef DUCT_DEBUG
             debugf(TRACE, "duct %s[receiver=%u]: candidate %u -> compare %u: data match; voting.",
@@ -230,19 +303,23 @@ size_t duct_receive_message(duct_txn_t *txn, void *message_out, local_time_t *ti
             best_votes = votes;
         }
         if (votes >= majority) {
+#if ( CONFIG_SYNCH_DUCT_DIGESTS == 1 )
+            // matching digests only prove that the senders agreed; make sure this copy wasn't corrupted after it was
+            // sent. a byte-for-byte match against another replica already proves that, even if the digest is what
+            // was corrupted.
+            if (!body_confirmed && duct_digest(candidate->body, candidate->size) != candidate->digest) {
+                miscomparef("duct %s[receiver=%u]: candidate %u won vote on index %u, but does not match its digest.",
+                            txn->duct->label, txn->replica_id, candidate_id, txn->flow_current);
+                continue;
+            }
+#endif
             if (votes != txn->duct->sender_replicas) {
                 miscomparef("duct %s[receiver=%u]: voted for a message with %u/%u/%u votes on index %u.",
                             txn->duct->label, txn->replica_id, votes, total_valid_messages, txn->duct->sender_replicas,
                             txn->flow_current);
             }
-            if (message_out != NULL) {
-                memcpy(message_out, candidate->body, candidate->size);
-            }
-            if (timestamp_out) {
-                *timestamp_out = candidate->timestamp;
-            }
             txn->flow_current += 1;
-            return candidate->size;
+            return candidate;
         }
     }
 
@@ -253,7 +330,37 @@ size_t duct_receive_message(duct_txn_t *txn, void *message_out, local_time_t *ti
     }
 
     /* indicate that there are no more valid messages for us to receive */
-    return 0;
+    return NULL;
+}
+
+// returns size > 0 if a message was successfully received. if size = 0, then we're done with this transaction.
+size_t duct_receive_message(duct_txn_t *txn, void *message_out, local_time_t *timestamp_out) {
+    duct_message_t *message = duct_vote_message(txn);
+    if (message == NULL) {
+        return 0;
+    }
+    if (message_out != NULL) {
+        memcpy(message_out, message->body, message->size);
+    }
+    if (timestamp_out) {
+        *timestamp_out = message->timestamp;
+    }
+    return message->size;
+}
+
+// the borrowed message lives in the sender's flow slot, which the sender only rewrites after this receive is committed.
+size_t duct_receive_borrow(duct_txn_t *txn, const uint8_t **message_out, local_time_t *timestamp_out) {
+    assert(message_out != NULL);
+    duct_message_t *message = duct_vote_message(txn);
+    if (message == NULL) {
+        *message_out = NULL;
+        return 0;
+    }
+    *message_out = message->body;
+    if (timestamp_out) {
+        *timestamp_out = message->timestamp;
+    }
+    return message->size;
 }
 
 // asserts if we left any messages unprocessed
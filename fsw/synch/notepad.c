@@ -12,6 +12,12 @@ static inline uint8_t *notepad_region_ref(notepad_ref_t *replica, uint8_t replic
     return &replica->mutable_state[(replica_id * 2 + flip_state) * replica->state_size];
 }
 
+static inline uint32_t *notepad_dirty_ref(notepad_ref_t *replica, uint8_t replica_id, uint8_t flip_state) {
+    assert(replica != NULL);
+    assert(flip_state == 0 || flip_state == 1);
+    return &replica->dirty_maps[(replica_id * 2 + flip_state) * replica->dirty_words];
+}
+
 static inline uint8_t notepad_vote_flip(notepad_ref_t *replica) {
     assert(replica != NULL);
     uint32_t count_secondary = 0;
@@ -40,7 +46,50 @@ static inline uint8_t notepad_vote_flip(notepad_ref_t *replica) {
     return (count_secondary >= majority) ? 1 : 0;
 }
 
-static bool notepad_vote_best(notepad_ref_t *replica, uint8_t flip_read, void *output_region) {
+// returns the blocks in one word of the dirty bitmap that any replica marked when it wrote its flip_read region.
+static uint32_t notepad_dirty_word(notepad_ref_t *replica, uint8_t flip_read, size_t word) {
+    uint32_t dirty = 0;
+    for (uint8_t i = 0; i < replica->num_replicas; i++) {
+        dirty |= notepad_dirty_ref(replica, i, flip_read)[word];
+    }
+    if (word == replica->dirty_words - 1 && replica->state_size % (NOTEPAD_BLOCK_SIZE * 32) != 0) {
+        // drop the padding bits in the last word, which are set when everything is dirty
+        size_t blocks = (replica->state_size % (NOTEPAD_BLOCK_SIZE * 32) + NOTEPAD_BLOCK_SIZE - 1) / NOTEPAD_BLOCK_SIZE;
+        dirty &= (1u << blocks) - 1;
+    }
+    return dirty;
+}
+
+static size_t notepad_block_length(notepad_ref_t *replica, size_t offset) {
+    assert(offset < replica->state_size);
+    size_t length = replica->state_size - offset;
+    return length > NOTEPAD_BLOCK_SIZE ? NOTEPAD_BLOCK_SIZE : length;
+}
+
+// compares only those blocks that any replica marked as dirty when it wrote its flip_read region.
+static bool notepad_dirty_equal(notepad_ref_t *replica, uint8_t flip_read, const uint8_t *a, const uint8_t *b) {
+    for (size_t word = 0; word < replica->dirty_words; word++) {
+        for (uint32_t dirty = notepad_dirty_word(replica, flip_read, word); dirty != 0; dirty &= dirty - 1) {
+            size_t offset = (word * 32 + __builtin_ctz(dirty)) * NOTEPAD_BLOCK_SIZE;
+            if (memcmp(a + offset, b + offset, notepad_block_length(replica, offset)) != 0) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// copies only those blocks that any replica marked as dirty when it wrote its flip_read region.
+static void notepad_dirty_copy(notepad_ref_t *replica, uint8_t flip_read, uint8_t *output, const uint8_t *input) {
+    for (size_t word = 0; word < replica->dirty_words; word++) {
+        for (uint32_t dirty = notepad_dirty_word(replica, flip_read, word); dirty != 0; dirty &= dirty - 1) {
+            size_t offset = (word * 32 + __builtin_ctz(dirty)) * NOTEPAD_BLOCK_SIZE;
+            memcpy(output + offset, input + offset, notepad_block_length(replica, offset));
+        }
+    }
+}
+
+static bool notepad_vote_best(notepad_ref_t *replica, uint8_t flip_read, void *output_region, bool full_vote) {
     if (flip_read == NOTEPAD_UNINITIALIZED) {
         debugf(DEBUG, "Blank notepad %s[%u]; initializing by reset.", replica->label, replica->replica_id);
         memset(output_region, 0, replica->state_size);
@@ -55,7 +104,8 @@ static bool notepad_vote_best(notepad_ref_t *replica, uint8_t flip_read, void *o
         uint8_t votes = 1;
         for (uint8_t compare_id = candidate_id + 1; compare_id < replica->num_replicas; compare_id++) {
             uint8_t *compare_data = notepad_region_ref(replica, compare_id, flip_read);
-            if (memcmp(candidate_data, compare_data, replica->state_size) == 0) {
+            if (full_vote ? memcmp(candidate_data, compare_data, replica->state_size) == 0
+                          : notepad_dirty_equal(replica, flip_read, candidate_data, compare_data)) {
                 votes++;
             }
         }
@@ -63,13 +113,29 @@ static bool notepad_vote_best(notepad_ref_t *replica, uint8_t flip_read, void *o
             best_vote = votes;
         }
         if (votes >= majority) {
-            memcpy(output_region, candidate_data, replica->state_size);
+            if (!full_vote && votes < replica->num_replicas) {
+                // the replicas disagree on something, so it's not safe to assume that they still agree on the clean
+                // blocks either. compare everything.
+                return notepad_vote_best(replica, flip_read, output_region, true);
+            } else if (full_vote) {
+                memcpy(output_region, candidate_data, replica->state_size);
+            } else {
+                // the clean blocks were only compared during the last full vote, so take them from our own copy. if
+                // they were taken from the winner, an upset in the winner's clean blocks would spread to every
+                // replica, and the next full vote would agree on the corrupted data.
+                memcpy(output_region, notepad_region_ref(replica, replica->replica_id, flip_read),
+                       replica->state_size);
+                notepad_dirty_copy(replica, flip_read, output_region, candidate_data);
+            }
             populated = true;
             break;
         }
     }
 
-    if (!populated) {
+    if (!populated && !full_vote) {
+        // a partial vote can't tell which replica to trust for the clean blocks; let a full vote decide.
+        return notepad_vote_best(replica, flip_read, output_region, true);
+    } else if (!populated) {
         miscomparef("No valid feedforward state found in notepad %s[%u], as best vote matched %u/%u; resetting.",
                     replica->label, replica->replica_id, best_vote, replica->num_replicas);
         memset(output_region, 0, replica->state_size);
@@ -81,22 +147,40 @@ static bool notepad_vote_best(notepad_ref_t *replica, uint8_t flip_read, void *o
     return true; /* valid */
 }
 
-// returns a structure populated with the current state, into which the new state should be written.
-void *notepad_feedforward(notepad_ref_t *replica, bool *valid_out) {
+static void *notepad_feedforward_internal(notepad_ref_t *replica, bool *valid_out, bool tracked) {
     assert(replica != NULL);
     assert(replica->replica_id < replica->num_replicas); // ensure this is not an observer
 
+    // voting reads every replica's regions, and expects the replicas to take their turns in order.
+    clip_note_access(replica->mutable_state, CLIP_ACCESS_EXCLUSIVE);
+
     uint8_t flip_read = notepad_vote_flip(replica);
     uint8_t flip_write = !flip_read; // opposite of flip_read; map flip_read=NOTEPAD_UNINITIALIZED to flip_write=0
     assert(flip_write == 0 || flip_write == 1);
 
     void *output_region = notepad_region_ref(replica, replica->replica_id, flip_write);
 
-    bool valid = notepad_vote_best(replica, flip_read, output_region);
+    // untracked writers may have modified any block, so everything is compared on the following cycle anyway.
+    bool full_vote = true;
+    if (tracked) {
+        uint8_t *counter = &replica->vote_counters[replica->replica_id];
+        *counter += 1;
+        if (*counter >= NOTEPAD_FULL_VOTE_INTERVAL) {
+            *counter = 0;
+        } else {
+            full_vote = false;
+        }
+    }
+
+    bool valid = notepad_vote_best(replica, flip_read, output_region, full_vote);
     if (valid_out != NULL) {
         *valid_out = valid;
     }
 
+    // a reset state is just as likely to differ from the other replicas as anything written by an untracked writer
+    uint32_t *dirty_map = notepad_dirty_ref(replica, replica->replica_id, flip_write);
+    memset(dirty_map, (tracked && valid) ? 0x00 : 0xFF, replica->dirty_words * sizeof(uint32_t));
+
     // designate the new region as containing new data
     replica->flip_states[replica->replica_id] = flip_write;
 
@@ -104,6 +188,55 @@ void *notepad_feedforward(notepad_ref_t *replica, bool *valid_out) {
     return output_region;
 }
 
+// returns a structure populated with the current state, into which the new state should be written.
+void *notepad_feedforward(notepad_ref_t *replica, bool *valid_out) {
+    return notepad_feedforward_internal(replica, valid_out, false);
+}
+
+void *notepad_feedforward_tracked(notepad_ref_t *replica, bool *valid_out) {
+    return notepad_feedforward_internal(replica, valid_out, true);
+}
+
+static void notepad_mark_blocks(notepad_ref_t *replica, uint8_t flip_write, size_t offset, size_t length) {
+    uint32_t *dirty_map = notepad_dirty_ref(replica, replica->replica_id, flip_write);
+    size_t first_block = offset / NOTEPAD_BLOCK_SIZE;
+    size_t last_block = (offset + length - 1) / NOTEPAD_BLOCK_SIZE;
+    for (size_t block = first_block; block <= last_block; block++) {
+        dirty_map[block / 32] |= 1u << (block % 32);
+    }
+}
+
+void notepad_mark_dirty(notepad_ref_t *replica, const void *field, size_t length) {
+    assert(replica != NULL && field != NULL);
+    assert(replica->replica_id < replica->num_replicas);
+    uint8_t flip_write = replica->flip_states[replica->replica_id];
+    assert(flip_write == 0 || flip_write == 1);
+
+    const uint8_t *region = notepad_region_ref(replica, replica->replica_id, flip_write);
+    assert((const uint8_t *) field >= region && length <= replica->state_size
+            && (size_t) ((const uint8_t *) field - region) <= replica->state_size - length);
+    if (length == 0) {
+        return;
+    }
+
+    notepad_mark_blocks(replica, flip_write, (const uint8_t *) field - region, length);
+}
+
+void notepad_mark_changes(notepad_ref_t *replica, const void *baseline) {
+    assert(replica != NULL && baseline != NULL);
+    assert(replica->replica_id < replica->num_replicas);
+    uint8_t flip_write = replica->flip_states[replica->replica_id];
+    assert(flip_write == 0 || flip_write == 1);
+
+    const uint8_t *region = notepad_region_ref(replica, replica->replica_id, flip_write);
+    for (size_t offset = 0; offset < replica->state_size; offset += NOTEPAD_BLOCK_SIZE) {
+        size_t length = notepad_block_length(replica, offset);
+        if (memcmp(region + offset, (const uint8_t *) baseline + offset, length) != 0) {
+            notepad_mark_blocks(replica, flip_write, offset, length);
+        }
+    }
+}
+
 #else /* ( CONFIG_SYNCH_NOTEPADS_ENABLED == 0 ) */
 
 void *notepad_feedforward(notepad_ref_t *replica, bool *valid_out) {
@@ -114,4 +247,17 @@ void *notepad_feedforward(notepad_ref_t *replica, bool *valid_out) {
     return replica->local_buffer;
 }
 
+void *notepad_feedforward_tracked(notepad_ref_t *replica, bool *valid_out) {
+    return notepad_feedforward(replica, valid_out);
+}
+
+void notepad_mark_dirty(notepad_ref_t *replica, const void *field, size_t length) {
+    assert(replica != NULL && field != NULL);
+    (void) length;
+}
+
+void notepad_mark_changes(notepad_ref_t *replica, const void *baseline) {
+    assert(replica != NULL && baseline != NULL);
+}
+
 #endif
@@ -31,6 +31,14 @@ void pipe_send_message(pipe_txn_t *txn, void *message, size_t size, local_time_t
     txn->available -= 1;
 }
 
+void pipe_send_message_split(pipe_txn_t *txn, const void *first, size_t first_size,
+                             const void *second, size_t second_size, local_time_t timestamp) {
+    assert(txn != NULL && first != NULL && first_size + second_size >= 1);
+    assert(txn->available > 0);
+    duct_send_message_split(&txn->data_txn, first, first_size, second, second_size, timestamp);
+    txn->available -= 1;
+}
+
 void pipe_send_commit(pipe_txn_t *txn) {
     assert(txn != NULL);
     duct_send_commit(&txn->data_txn);
@@ -54,6 +62,15 @@ size_t pipe_receive_message(pipe_txn_t *txn, void *message_out, local_time_t *ti
     return count;
 }
 
+size_t pipe_receive_borrow(pipe_txn_t *txn, const uint8_t **message_out, local_time_t *timestamp_out) {
+    assert(txn != NULL);
+    size_t count = duct_receive_borrow(&txn->data_txn, message_out, timestamp_out);
+    if (count > 0 && txn->available > 0) {
+        txn->available -= 1;
+    }
+    return count;
+}
+
 void pipe_receive_commit(pipe_txn_t *txn, duct_flow_index requested_count) {
     assert(txn != NULL && txn->pipe != NULL);
     duct_flow_index extra_messages = 0;
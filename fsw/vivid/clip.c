@@ -27,6 +27,10 @@ __attribute__((noreturn)) void clip_play_direct(void (*entrypoint)(void*)) {
         clip->mut->needs_start = true;
     } else if (atomic_load(clip->mut->clip_running)) {
         malfunctionf("Clip %s did not have a chance to complete by the end of its execution!", clip->label);
+        // the previous run was cut off when its partition ended, so it took (at least) its entire budget.
+        uint32_t overran = clip->mut->clip_partition;
+        profile_record(&schedule_profiles[overran], schedule_partitions[overran].nanos,
+                       schedule_partitions[overran].nanos, true);
         clip->mut->needs_start = true;
     } else {
         uint32_t now = schedule_tick_index();
@@ -37,6 +41,7 @@ __attribute__((noreturn)) void clip_play_direct(void (*entrypoint)(void*)) {
         }
     }
 
+    clip->mut->clip_partition = schedule_index;
     atomic_store(clip->mut->clip_running, true);
 
     // actual execution body
@@ -51,8 +56,11 @@ __attribute__((noreturn)) void clip_play_direct(void (*entrypoint)(void*)) {
     clip->mut->needs_start = false;
 
     int64_t elapsed = timer_now_ns() - schedule_period_start;
-    if (elapsed > 0 && (uint64_t) elapsed > clip->mut->clip_max_nanos) {
-        clip->mut->clip_max_nanos = elapsed;
+    uint32_t partition = clip->mut->clip_partition;
+    profile_t *profile = &schedule_profiles[partition];
+    uint32_t previous_max = profile->max_ns;
+    profile_record(profile, schedule_partitions[partition].nanos, elapsed > 0 ? elapsed : 0, false);
+    if (profile->max_ns > previous_max) {
         debugf(TRACE, "New longest clip duration for %s: %u.%03u microseconds.",
                clip->label, elapsed / 1000, elapsed % 1000);
     }
@@ -61,3 +69,19 @@ __attribute__((noreturn)) void clip_play_direct(void (*entrypoint)(void*)) {
     schedule_yield();
     abortf("It should be impossible for any clip to ever resume from yield!");
 }
+
+uint32_t clip_profile_partitions(void) {
+    return schedule_partitions_length;
+}
+
+bool clip_profile_summary(uint32_t partition, profile_summary_t *out, const char **label_out) {
+    assert(out != NULL);
+    if (partition >= schedule_partitions_length) {
+        return false;
+    }
+    profile_summarize(&schedule_profiles[partition], schedule_partitions[partition].nanos, out);
+    if (label_out != NULL) {
+        *label_out = schedule_partitions[partition].clip->label;
+    }
+    return true;
+}
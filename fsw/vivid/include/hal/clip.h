@@ -51,4 +51,17 @@ static inline void clip_assert(void) {
     // always a clip on Vivid
 }
 
+enum clip_access {
+    CLIP_ACCESS_EXCLUSIVE = 0,
+    CLIP_ACCESS_SEND,
+    CLIP_ACCESS_RECEIVE,
+    CLIP_ACCESS_BARRIER,
+};
+
+// only used to plan parallel execution on Linux; clips on Vivid always run one at a time
+static inline void clip_note_access(const void *resource, enum clip_access access) {
+    (void) resource;
+    (void) access;
+}
+
 #endif /* FSW_VIVID_HAL_CLIP_H */
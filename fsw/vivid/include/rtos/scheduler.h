@@ -7,6 +7,7 @@
 
 #include <rtos/config.h>
 #include <hal/debug.h>
+#include <hal/profile.h>
 
 typedef struct {
     uint64_t iteration[VIVID_SCRUBBER_COPIES];
@@ -23,7 +24,7 @@ typedef struct {
 #if ( VIVID_RECOVERY_WAIT_FOR_SCRUBBER == 1 )
     scrubber_pend_t clip_pend;
 #endif
-    uint64_t        clip_max_nanos;
+    uint32_t        clip_partition; // index of the schedule partition in which the clip was last started
 } clip_mut_t;
 
 typedef const struct {
@@ -42,6 +43,8 @@ typedef struct {
 // array containing the scheduling order for these clips, defined statically using SCHEDULE_PARTITION_ORDER
 extern const schedule_entry_t schedule_partitions[];
 extern const uint32_t         schedule_partitions_length;
+// execution times of each entry in schedule_partitions
+extern profile_t              schedule_profiles[];
 
 macro_define(CLIP_SCHEDULE, c_ident, c_micros) {
     { .clip = &(c_ident), .nanos = (c_micros) * 1000 },
@@ -52,8 +55,10 @@ macro_block_define(SCHEDULE_PARTITION_ORDER, body) {
         body
     };
     const uint32_t schedule_partitions_length = PP_ARRAY_SIZE(schedule_partitions);
+    profile_t schedule_profiles[PP_ARRAY_SIZE(schedule_partitions)];
 }
 
+extern uint32_t schedule_index;
 extern uint64_t schedule_loads;
 extern uint32_t schedule_ticks;
 extern local_time_t schedule_period_start;
@@ -7,7 +7,7 @@
 #include <rtos/scheduler.h>
 #include <hal/atomic.h>
 
-static uint32_t schedule_index = 0;
+uint32_t schedule_index = 0;
 uint64_t schedule_loads = 0;
 uint32_t schedule_ticks = 0;
 local_time_t schedule_period_start = 0;
@@ -13,7 +13,10 @@ import (
 type ExchangeState uint8
 
 const (
-	MaxOutstandingTokens = 10
+	// upper bound on the flow control window either end may grant; must match MAX_OUTSTANDING_TOKENS in the FSW
+	MaxOutstandingTokens = 254
+	// number of packets the simulator authorizes the remote end to send ahead of what has been received
+	ReceiveWindow = 10
 )
 
 const DetailedDebug = false
@@ -296,7 +299,7 @@ func FakeWire(ctx model.SimContext, lsink model.DataSinkBytes, lsource model.Dat
 			if ex.RecvInProgress {
 				pending += 1
 			}
-			if ex.State == StateOperating && !ex.TxBusy && ex.FctsSent < ex.PktsRcvd+MaxOutstandingTokens-pending {
+			if ex.State == StateOperating && !ex.TxBusy && ex.FctsSent < ex.PktsRcvd+ReceiveWindow-pending {
 				ex.FctsSent += 1
 				ex.Transmit(io, lsink, codec.EncodeCtrlChar(codec.ChFlowControl, ex.FctsSent))
 			} else if len(ex.InboundPending) > 0 && psink.CanAcceptPacket() {
@@ -17,8 +17,10 @@ const (
 	PongTID               = 0x01000005
 	ClockCalibratedTID    = 0x01000006
 	HeartbeatTID          = 0x01000007
+	ClipProfileTID        = 0x01000008
 	MagPwrStateChangedTID = 0x02000001
 	MagReadingsArrayTID   = 0x02000002
+	MagReadingsDeltaTID   = 0x02000003
 )
 
 type BaseTelemetry struct{}
@@ -82,11 +84,13 @@ func (c *CmdNotRecognized) String() string {
 
 type TlmDropped struct {
 	BaseTelemetry
-	MessagesLost uint32
+	CriticalLost uint32
+	NormalLost   uint32
+	BulkLost     uint32
 }
 
 func (t *TlmDropped) String() string {
-	return fmt.Sprintf("TlmDropped(Messages=%d)", t.MessagesLost)
+	return fmt.Sprintf("TlmDropped(Critical=%d, Normal=%d, Bulk=%d)", t.CriticalLost, t.NormalLost, t.BulkLost)
 }
 
 type Pong struct {
@@ -115,6 +119,22 @@ func (h *Heartbeat) String() string {
 	return "Heartbeat"
 }
 
+type ClipProfile struct {
+	BaseTelemetry
+	Partition  uint8
+	Runs       uint32
+	Overruns   uint16
+	MinMicros  uint16
+	MeanMicros uint16
+	P99Micros  uint16
+	MaxMicros  uint16
+}
+
+func (c *ClipProfile) String() string {
+	return fmt.Sprintf("ClipProfile(Partition=%d, Runs=%d, Overruns=%d, Min=%dus, Mean=%dus, P99=%dus, Max=%dus)",
+		c.Partition, c.Runs, c.Overruns, c.MinMicros, c.MeanMicros, c.P99Micros, c.MaxMicros)
+}
+
 type MagPwrStateChanged struct {
 	BaseTelemetry
 	PowerState bool
@@ -157,6 +177,9 @@ func (m *MagReadingsArray) Decode(_ Telemetry, dataBytes []byte, tlmId uint32) e
 	if err := binary.Read(r, binary.BigEndian, &m.Header); err != nil {
 		return fmt.Errorf("while decoding %d bytes into header for ID %08x: %v", len(dataBytes), tlmId, err)
 	}
+	if tlmId == MagReadingsDeltaTID {
+		return m.decodeDeltas(r, len(dataBytes), tlmId)
+	}
 	for r.Len() > 0 {
 		var mr MagReading
 		if err := binary.Read(r, binary.BigEndian, &mr); err != nil {
@@ -170,6 +193,37 @@ func (m *MagReadingsArray) Decode(_ Telemetry, dataBytes []byte, tlmId uint32) e
 	return nil
 }
 
+// decodeDeltas decodes the delta-encoded form: one complete reading, followed by varints for each subsequent reading,
+// giving the change in the interval between reading times and then the change in each axis.
+func (m *MagReadingsArray) decodeDeltas(r *bytes.Reader, dataLen int, tlmId uint32) error {
+	var last MagReading
+	if err := binary.Read(r, binary.BigEndian, &last); err != nil {
+		return fmt.Errorf("while decoding %d bytes into delta-based ID %08x: %v", dataLen, tlmId, err)
+	}
+	m.Readings = append(m.Readings, last)
+	var lastInterval uint64
+	for r.Len() > 0 {
+		var deltas [4]int64
+		for i := range deltas {
+			delta, err := binary.ReadVarint(r)
+			if err != nil {
+				return fmt.Errorf("while decoding %d bytes into delta-based ID %08x: %v", dataLen, tlmId, err)
+			}
+			deltas[i] = delta
+		}
+		interval := lastInterval + uint64(deltas[0])
+		next := MagReading{
+			ReadingTime: last.ReadingTime + interval,
+			MagX:        int16(int64(last.MagX) + deltas[1]),
+			MagY:        int16(int64(last.MagY) + deltas[2]),
+			MagZ:        int16(int64(last.MagZ) + deltas[3]),
+		}
+		m.Readings = append(m.Readings, next)
+		last, lastInterval = next, interval
+	}
+	return nil
+}
+
 func DecodeTelemetry(cp *CommPacket) (t Telemetry, timestamp model.VirtualTime, err error) {
 	if cp.MagicNumber != MagicNumTlm {
 		return nil, 0, fmt.Errorf("wrong magic number: %08x instead of %08x", cp.MagicNumber, MagicNumTlm)
@@ -194,7 +248,9 @@ func DecodeTelemetry(cp *CommPacket) (t Telemetry, timestamp model.VirtualTime,
 		t = &ClockCalibrated{}
 	case HeartbeatTID:
 		t = &Heartbeat{}
-	case MagReadingsArrayTID:
+	case ClipProfileTID:
+		t = &ClipProfile{}
+	case MagReadingsArrayTID, MagReadingsDeltaTID:
 		t = &MagReadingsArray{}
 	default:
 		return nil, 0, fmt.Errorf("unrecognized telemetry ID: %08x", cp.CmdTlmId)
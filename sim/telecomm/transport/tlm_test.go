@@ -0,0 +1,55 @@
+package transport
+
+import (
+	"reflect"
+	"testing"
+)
+
+// produced by tlm_mag_readings_map in fsw/flight/telemetry.c for four readings whose intervals and axes both grow and
+// shrink, so that every kind of delta is negative at least once.
+var magReadingsDeltaVector = []byte{
+	0x00, 0x00, 0x00, 0x00, 0x38, 0x9f, 0xd9, 0x80, 0x00, 0x00, 0x00, 0x00,
+	0x50, 0x77, 0x5d, 0x7f, 0x00, 0x00, 0x00, 0x00, 0x3b, 0x9a, 0xca, 0x00,
+	0x00, 0x64, 0xff, 0xce, 0x00, 0x07, 0x80, 0x84, 0xaf, 0x5f, 0x13, 0x13,
+	0x00, 0xcf, 0x0f, 0xdb, 0x01, 0xd0, 0x05, 0x8d, 0x80, 0x04, 0xa0, 0x1f,
+	0xa6, 0x80, 0x04, 0xd7, 0x84, 0x04, 0xfe, 0xff, 0x07,
+}
+
+// produced by the same function for two readings too far apart for the delta encoding to come out any smaller, so it
+// fell back to fixed-size records under MagReadingsArrayTID.
+var magReadingsFallbackVector = []byte{
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x04, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x09, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x05,
+	0x80, 0x00, 0x7f, 0xff, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x05, 0x7f, 0xff, 0x80, 0x00, 0x80, 0x00,
+}
+
+func checkMagReadings(t *testing.T, vector []byte, tlmId uint32, earliest, latest uint64, expected []MagReading) {
+	m := &MagReadingsArray{}
+	if err := m.Decode(m, vector, tlmId); err != nil {
+		t.Fatalf("failed to decode readings for ID %08x: %v", tlmId, err)
+	}
+	if m.Header.EarliestTime != earliest || m.Header.LatestTime != latest {
+		t.Errorf("wrong header: got [%d, %d], expected [%d, %d]",
+			m.Header.EarliestTime, m.Header.LatestTime, earliest, latest)
+	}
+	if !reflect.DeepEqual(m.Readings, expected) {
+		t.Errorf("wrong readings:\n got      %v\n expected %v", m.Readings, expected)
+	}
+}
+
+func TestMagReadingsDeltaFromFlightSoftware(t *testing.T) {
+	checkMagReadings(t, magReadingsDeltaVector, MagReadingsDeltaTID, 950000000, 1349999999, []MagReading{
+		{ReadingTime: 1000000000, MagX: 100, MagY: -50, MagZ: 7},
+		{ReadingTime: 1100000000, MagX: 90, MagY: -60, MagZ: 7},
+		{ReadingTime: 1199999000, MagX: -20, MagY: 300, MagZ: -32768},
+		{ReadingTime: 1300000000, MagX: 32767, MagY: -32768, MagZ: 32767},
+	})
+}
+
+func TestMagReadingsFallbackFromFlightSoftware(t *testing.T) {
+	checkMagReadings(t, magReadingsFallbackVector, MagReadingsArrayTID, 1, (1<<50)+9, []MagReading{
+		{ReadingTime: 5, MagX: -32768, MagY: 32767, MagZ: 0},
+		{ReadingTime: 5 + (1 << 50), MagX: 32767, MagY: -32768, MagZ: -32768},
+	})
+}